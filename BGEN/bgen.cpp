@@ -359,7 +359,7 @@ namespace genfile {
 			std::istream& aStream,
 			Context const& context
 		) {
-			if( context.flags & bgen::e_CompressedSNPBlocks ) {
+			if( (context.flags & e_Layout) == e_v12Layout || (context.flags & bgen::e_CompressedSNPBlocks) ) {
 				uint32_t compressed_data_size = 0 ;
 				read_little_endian_integer( aStream, &compressed_data_size ) ;
 				aStream.ignore( compressed_data_size ) ;
@@ -384,15 +384,38 @@ namespace genfile {
 			aStream.read( reinterpret_cast< char* >( &(*buffer)[0] ), payload_size ) ;
 		}
 
+		void read_genotype_data_block(
+			byte_t const** buffer,
+			byte_t const* const end,
+			Context const& context,
+			byte_t const** payload,
+			byte_t const** payload_end
+		) {
+			byte_t const* p = *buffer ;
+			uint32_t payload_size = 0 ;
+			if( (context.flags & e_Layout) == e_v12Layout || (context.flags & e_CompressedSNPBlocks) ) {
+				if( end - p < 4 ) {
+					throw BGenError() ;
+				}
+				p = read_little_endian_integer( p, end, &payload_size ) ;
+			} else {
+				payload_size = 6 * context.number_of_samples ;
+			}
+			if( std::size_t( end - p ) < payload_size ) {
+				throw BGenError() ;
+			}
+			*payload = p ;
+			*payload_end = p + payload_size ;
+			*buffer = p + payload_size ;
+		}
+
 		void uncompress_probability_data(
 			Context const& context,
-			std::vector< byte_t > const& compressed_data,
+			byte_t const* begin,
+			byte_t const* const end,
 			std::vector< byte_t >* buffer
 		) {
-			// compressed_data contains the (compressed or uncompressed) probability data.
 			if( context.flags & bgen::e_CompressedSNPBlocks ) {
-				byte_t const* begin = &compressed_data[0] ;
-				byte_t const* const end = &compressed_data[0] + compressed_data.size() ;
 				uint32_t uncompressed_data_size = 0 ;
 				if( (context.flags & e_Layout) == e_v11Layout ) {
 					uncompressed_data_size = 6 * context.number_of_samples ;
@@ -400,15 +423,34 @@ namespace genfile {
 					begin = read_little_endian_integer( begin, end, &uncompressed_data_size ) ;
 				}
 				buffer->resize( uncompressed_data_size ) ;
-				zlib_uncompress( begin, end, buffer ) ;
+				if( (context.flags & bgen::e_CompressedSNPBlocks) == e_ZstdCompression ) {
+					if( !zstd_uncompress( begin, end, buffer ) || buffer->size() != uncompressed_data_size ) {
+						throw BGenError() ;
+					}
+				} else {
+					zlib_uncompress( begin, end, buffer ) ;
+				}
 				assert( buffer->size() == uncompressed_data_size ) ;
 			}
 			else {
-				// copy the data between buffers.
-				buffer->assign( compressed_data.begin(), compressed_data.end() ) ;
+				buffer->assign( begin, end ) ;
 			}
 		}
 
+		void uncompress_probability_data(
+			Context const& context,
+			std::vector< byte_t > const& compressed_data,
+			std::vector< byte_t >* buffer
+		) {
+			// compressed_data contains the (compressed or uncompressed) probability data.
+			uncompress_probability_data(
+				context,
+				&compressed_data[0],
+				&compressed_data[0] + compressed_data.size(),
+				buffer
+			) ;
+		}
+
 		namespace v12 {
 			namespace impl {
 				// Fill a data field, encoded as a 64-bit integer, with bytes
@@ -12,8 +12,11 @@
 #include <cassert>
 #include <cmath>
 #include <stdint.h>
+#include <string_view>
 
 #include "zlib.hpp"
+#include "zstd.hpp"
+#include "unpack.hpp"
 #include "types.hpp"
 #include "MissingValue.hpp"
 
@@ -81,7 +84,8 @@ namespace genfile {
 		typedef ::uint16_t uint16_t ;
 
 		// Header flag definitions
-		enum FlagMask { e_NoFlags = 0, e_CompressedSNPBlocks = 0x1, e_Layout = 0x3C } ;
+		enum FlagMask { e_NoFlags = 0, e_CompressedSNPBlocks = 0x3, e_Layout = 0x3C } ;
+		enum Compression { e_NoCompression = 0x0, e_ZlibCompression = 0x1, e_ZstdCompression = 0x2 } ;
 		enum Layout { e_v10Layout = 0x0, e_v11Layout = 0x4, e_v12Layout = 0x8 } ;
 		enum Structure { e_SampleIdentifiers = 0x80000000 } ;
 
@@ -177,6 +181,28 @@ namespace genfile {
 			std::string* second_allele
 		) ;
 
+		// Read identifying data for the next variant from a buffer holding the file contents
+		// (e.g. a memory-mapped file), starting at *buffer.  On success *buffer is moved past
+		// the identifying data and the fields are returned as views into the buffer, which are
+		// valid for as long as the buffer is.  Returns false if *buffer is at the end, and throws
+		// a BGenError if the data is truncated.  Only v1.1 and v1.2 layouts are supported.
+		// The allele setter is called with a std::string_view.
+		template<
+			typename NumberOfAllelesSetter,
+			typename AlleleSetter
+		>
+		bool read_snp_identifying_data(
+			byte_t const** buffer,
+			byte_t const* const end,
+			Context const& context,
+			std::string_view* SNPID,
+			std::string_view* RSID,
+			std::string_view* chromosome,
+			uint32_t* SNP_position,
+			NumberOfAllelesSetter set_number_of_alleles,
+			AlleleSetter set_allele
+		) ;
+
 		// Write identifying data fields for the given variant.
 		void write_snp_identifying_data(
 			std::ostream& aStream,
@@ -210,6 +236,17 @@ namespace genfile {
 			std::vector< byte_t >* buffer1
 		) ;
 
+		// As above, but locates the genotype data block at *buffer in memory without copying it.
+		// On return [*payload, *payload_end) holds the raw probability data and *buffer points
+		// to the next variant.
+		void read_genotype_data_block(
+			byte_t const** buffer,
+			byte_t const* const end,
+			Context const& context,
+			byte_t const** payload,
+			byte_t const** payload_end
+		) ;
+
 		// Low-level function which uncompresses probability data stored in the genotype data block
 		// contained in the first buffer into a second buffer (or just copies it over if the probability
 		// data is not compressed.) The second buffer will be resized to fit the result (incurring an
@@ -226,6 +263,15 @@ namespace genfile {
 			std::vector< byte_t >* buffer2
 		) ;
 
+		// As above, taking the compressed data from the range [begin, end), e.g. directly
+		// from a memory-mapped file.
+		void uncompress_probability_data(
+			Context const& context,
+			byte_t const* begin,
+			byte_t const* const end,
+			std::vector< byte_t >* buffer
+		) ;
+
 		// template< typename Setter >
 		// parse uncompressed genotype probability data stored in the given buffer.
 		// Values are returned as doubles or as missing values using the
@@ -342,6 +388,21 @@ namespace genfile {
 			string_ptr->assign( buffer.begin(), buffer.end() ) ;
 		}
 
+		// Read length-prefixed data from a buffer, returning a view of it.
+		// Throws a BGenError if the buffer does not hold the whole field.
+		template< typename IntegerType >
+		byte_t const* read_length_followed_by_data( byte_t const* buffer, byte_t const* const end, IntegerType* length_ptr, std::string_view* string_ptr ) {
+			if( end < buffer + sizeof( IntegerType )) {
+				throw BGenError() ;
+			}
+			buffer = read_little_endian_integer( buffer, end, length_ptr ) ;
+			if( std::size_t( end - buffer ) < std::size_t( *length_ptr )) {
+				throw BGenError() ;
+			}
+			*string_ptr = std::string_view( reinterpret_cast< char const* >( buffer ), *length_ptr ) ;
+			return buffer + *length_ptr ;
+		}
+
 		// Write an integer to the buffer in little-endian format.
 		template< typename IntegerType >
 		byte_t* write_little_endian_integer( byte_t* buffer, byte_t* const end, IntegerType const integer ) {
@@ -462,6 +523,69 @@ namespace genfile {
 			return true ;
 		}
 
+		template<
+			typename NumberOfAllelesSetter,
+			typename AlleleSetter
+		>
+		bool read_snp_identifying_data(
+			byte_t const** buffer,
+			byte_t const* const end,
+			Context const& context,
+			std::string_view* SNPID,
+			std::string_view* RSID,
+			std::string_view* chromosome,
+			uint32_t* SNP_position,
+			NumberOfAllelesSetter set_number_of_alleles,
+			AlleleSetter set_allele
+		) {
+			uint16_t SNPID_size = 0;
+			uint16_t RSID_size = 0;
+			uint16_t numberOfAlleles = 0 ;
+			uint16_t chromosome_size = 0 ;
+			uint32_t allele_size = 0;
+			std::string_view allele ;
+			uint32_t const layout = context.flags & e_Layout ;
+			byte_t const* p = *buffer ;
+
+			if( p == end ) {
+				return false ;
+			}
+			if( layout == e_v11Layout ) {
+				uint32_t number_of_samples ;
+				if( end - p < 4 ) {
+					throw BGenError() ;
+				}
+				p = read_little_endian_integer( p, end, &number_of_samples ) ;
+				if( number_of_samples != context.number_of_samples ) {
+					throw BGenError() ;
+				}
+			} else if( layout != e_v12Layout ) {
+				assert(0) ;
+			}
+			p = read_length_followed_by_data( p, end, &SNPID_size, SNPID ) ;
+			p = read_length_followed_by_data( p, end, &RSID_size, RSID ) ;
+			p = read_length_followed_by_data( p, end, &chromosome_size, chromosome ) ;
+			if( end - p < 4 ) {
+				throw BGenError() ;
+			}
+			p = read_little_endian_integer( p, end, SNP_position ) ;
+			if( layout == e_v12Layout ) {
+				if( end - p < 2 ) {
+					throw BGenError() ;
+				}
+				p = read_little_endian_integer( p, end, &numberOfAlleles ) ;
+			} else {
+				numberOfAlleles = 2 ;
+			}
+			set_number_of_alleles( numberOfAlleles ) ;
+			for( uint16_t i = 0; i < numberOfAlleles; ++i ) {
+				p = read_length_followed_by_data( p, end, &allele_size, &allele ) ;
+				set_allele( i, allele ) ;
+			}
+			*buffer = p ;
+			return true ;
+		}
+
 		namespace {
 			// TODO: make this C++-03 compatible.
 			template< typename Setter >
@@ -703,6 +827,38 @@ namespace genfile {
 				setter.initialise( numberOfSamples, uint32_t( numberOfAlleles ) ) ;
 				call_set_min_max_ploidy( setter, uint32_t( ploidyExtent[0] ), uint32_t( ploidyExtent[1] ), numberOfAlleles, phased ) ;
 
+				if(
+					!phased && numberOfAlleles == 2 && ploidyExtent[0] == 2 && ploidyExtent[1] == 2
+					&& numberOfSamples > 0 && impl::can_unpack_probabilities( bits )
+				) {
+					// Common case of unphased diploid biallelic data: each sample stores two values,
+					// which are decoded for all samples at once.
+					static thread_local std::vector< double > values ;
+					values.resize( 2 * std::size_t( numberOfSamples )) ;
+					impl::unpack_probabilities( buffer, end, values.size(), bits, &values[0] ) ;
+					for( uint32_t i = 0; i < numberOfSamples; ++i, ++ploidy_p ) {
+						if( setter.set_sample( i ) ) {
+							setter.set_number_of_entries( 2, 3, ePerUnorderedGenotype, eProbability ) ;
+							if( *ploidy_p & 0x80 ) {
+								for( uint32_t h = 0; h < 3; ++h ) {
+									setter.set_value( h, genfile::MissingValue() ) ;
+								}
+							} else {
+								double const* p = &values[ 2*i ] ;
+								double sum = 0.0 ;
+								sum += p[0] ;
+								sum += p[1] ;
+								assert( sum <= 1.00000001 ) ;
+								setter.set_value( 0, p[0] ) ;
+								setter.set_value( 1, p[1] ) ;
+								setter.set_value( 2, 1.0 - sum ) ;
+							}
+						}
+					}
+					call_finalise( setter ) ;
+					return ;
+				}
+
 				{
 					uint64_t data = 0 ;
 					int size = 0 ;
@@ -1067,6 +1223,7 @@ namespace genfile {
 			) ;
 			assert( p = &(*buffer)[0] + uncompressed_data_size ) ;
 
+			assert( (context.flags & e_CompressedSNPBlocks) != e_ZstdCompression ) ;
 			if( context.flags & e_CompressedSNPBlocks ) {
 	#if HAVE_ZLIB
 				uLongf compression_buffer_size = 12 + (1.1 * uncompressed_data_size) ;		// calculated according to zlib manual.
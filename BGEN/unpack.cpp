@@ -0,0 +1,168 @@
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <stdint.h>
+#include "unpack.hpp"
+#include "bgen.hpp"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define GENFILE_UNPACK_X86 1
+#include <immintrin.h>
+#else
+#define GENFILE_UNPACK_X86 0
+#endif
+
+namespace genfile {
+	namespace bgen {
+		namespace v12 {
+			namespace impl {
+				namespace {
+					// Decodes values [0, count) and returns the number of values decoded; the SIMD
+					// kernels stop early where a full vector load would run past the end of the buffer.
+					typedef std::size_t (*UnpackKernel)( byte_t const*, byte_t const* const, std::size_t const, int const, double* ) ;
+
+					std::size_t unpack_scalar(
+						byte_t const* buffer,
+						byte_t const* const end,
+						std::size_t const count,
+						int const bits,
+						double* result
+					) {
+						uint64_t const mask = ( 0xFFFFFFFFFFFFFFFF >> ( 64 - bits )) ;
+						double const scale = double( mask ) ;
+						uint64_t data = 0 ;
+						int size = 0 ;
+						for( std::size_t i = 0; i < count; ++i ) {
+							while( size < bits ) {
+								data |= uint64_t( *buffer++ ) << size ;
+								size += 8 ;
+							}
+							result[i] = ( data & mask ) / scale ;
+							data >>= bits ;
+							size -= bits ;
+						}
+						return count ;
+					}
+
+#if GENFILE_UNPACK_X86
+					// Four values of b bits take b/2 bytes.  For each of the four 32-bit lanes of a
+					// 16-byte load, the shuffle picks the two bytes holding the lane's value and the
+					// shift aligns it; a mask then removes the neighbouring bits.
+					struct UnpackTable {
+						UnpackTable( int const bits ) {
+							for( int k = 0; k < 4; ++k ) {
+								int const offset = bits * k ;
+								for( int j = 0; j < 4; ++j ) {
+									shuffle[ 4*k + j ] = ( j < 2 ) ? ( offset / 8 + j ) : 0x80 ;
+								}
+								shift[k] = offset % 8 ;
+							}
+						}
+						alignas(16) uint8_t shuffle[16] ;
+						alignas(16) uint32_t shift[4] ;
+					} ;
+
+					UnpackTable const& unpack_table( int const bits ) {
+						static UnpackTable const t8( 8 ), t10( 10 ), t12( 12 ), t16( 16 ) ;
+						switch( bits ) {
+							case 8: return t8 ;
+							case 10: return t10 ;
+							case 12: return t12 ;
+							default: return t16 ;
+						}
+					}
+
+					__attribute__(( target( "avx2" )))
+					std::size_t unpack_avx2(
+						byte_t const* buffer,
+						byte_t const* const end,
+						std::size_t const count,
+						int const bits,
+						double* result
+					) {
+						UnpackTable const& table = unpack_table( bits ) ;
+						__m256i const shuffle = _mm256_broadcastsi128_si256( _mm_load_si128( reinterpret_cast< __m128i const* >( table.shuffle ))) ;
+						__m256i const shift = _mm256_broadcastsi128_si256( _mm_load_si128( reinterpret_cast< __m128i const* >( table.shift ))) ;
+						__m256i const mask = _mm256_set1_epi32( ( 1 << bits ) - 1 ) ;
+						__m256d const scale = _mm256_set1_pd( double( ( 1 << bits ) - 1 )) ;
+						std::size_t i = 0 ;
+						// eight values per step, taking 'bits' bytes
+						for( ; i + 8 <= count && end - buffer >= bits/2 + 16; i += 8, buffer += bits ) {
+							__m128i const lo = _mm_loadu_si128( reinterpret_cast< __m128i const* >( buffer )) ;
+							__m128i const hi = _mm_loadu_si128( reinterpret_cast< __m128i const* >( buffer + bits/2 )) ;
+							__m256i v = _mm256_inserti128_si256( _mm256_castsi128_si256( lo ), hi, 1 ) ;
+							v = _mm256_and_si256( _mm256_srlv_epi32( _mm256_shuffle_epi8( v, shuffle ), shift ), mask ) ;
+							_mm256_storeu_pd( result + i, _mm256_div_pd( _mm256_cvtepi32_pd( _mm256_castsi256_si128( v )), scale )) ;
+							_mm256_storeu_pd( result + i + 4, _mm256_div_pd( _mm256_cvtepi32_pd( _mm256_extracti128_si256( v, 1 )), scale )) ;
+						}
+						return i ;
+					}
+
+					__attribute__(( target( "avx512f,avx512bw" )))
+					std::size_t unpack_avx512(
+						byte_t const* buffer,
+						byte_t const* const end,
+						std::size_t const count,
+						int const bits,
+						double* result
+					) {
+						UnpackTable const& table = unpack_table( bits ) ;
+						__m512i const shuffle = _mm512_broadcast_i32x4( _mm_load_si128( reinterpret_cast< __m128i const* >( table.shuffle ))) ;
+						__m512i const shift = _mm512_broadcast_i32x4( _mm_load_si128( reinterpret_cast< __m128i const* >( table.shift ))) ;
+						__m512i const mask = _mm512_set1_epi32( ( 1 << bits ) - 1 ) ;
+						__m512d const scale = _mm512_set1_pd( double( ( 1 << bits ) - 1 )) ;
+						std::size_t i = 0 ;
+						// sixteen values per step, taking 2*bits bytes
+						for( ; i + 16 <= count && end - buffer >= 3*bits/2 + 16; i += 16, buffer += 2*bits ) {
+							__m512i v = _mm512_castsi128_si512( _mm_loadu_si128( reinterpret_cast< __m128i const* >( buffer ))) ;
+							v = _mm512_inserti32x4( v, _mm_loadu_si128( reinterpret_cast< __m128i const* >( buffer + bits/2 )), 1 ) ;
+							v = _mm512_inserti32x4( v, _mm_loadu_si128( reinterpret_cast< __m128i const* >( buffer + bits )), 2 ) ;
+							v = _mm512_inserti32x4( v, _mm_loadu_si128( reinterpret_cast< __m128i const* >( buffer + 3*bits/2 )), 3 ) ;
+							v = _mm512_and_si512( _mm512_srlv_epi32( _mm512_shuffle_epi8( v, shuffle ), shift ), mask ) ;
+							_mm512_storeu_pd( result + i, _mm512_div_pd( _mm512_cvtepi32_pd( _mm512_castsi512_si256( v )), scale )) ;
+							_mm512_storeu_pd( result + i + 8, _mm512_div_pd( _mm512_cvtepi32_pd( _mm512_extracti64x4_epi64( v, 1 )), scale )) ;
+						}
+						return i ;
+					}
+#endif
+
+					UnpackKernel choose_kernel() {
+#if GENFILE_UNPACK_X86
+						__builtin_cpu_init() ;
+						if( __builtin_cpu_supports( "avx512f" ) && __builtin_cpu_supports( "avx512bw" ) ) {
+							return &unpack_avx512 ;
+						}
+						if( __builtin_cpu_supports( "avx2" ) ) {
+							return &unpack_avx2 ;
+						}
+#endif
+						return &unpack_scalar ;
+					}
+				}
+
+				bool can_unpack_probabilities( int const bits ) {
+					return bits == 8 || bits == 10 || bits == 12 || bits == 16 ;
+				}
+
+				void unpack_probabilities(
+					byte_t const* buffer,
+					byte_t const* const end,
+					std::size_t const count,
+					int const bits,
+					double* result
+				) {
+					assert( can_unpack_probabilities( bits )) ;
+					if( std::size_t( end - buffer ) < ( count * bits + 7 ) / 8 ) {
+						throw BGenError() ;
+					}
+					static UnpackKernel const kernel = choose_kernel() ;
+					std::size_t const done = kernel( buffer, end, count, bits, result ) ;
+					// kernels stop on a whole byte
+					unpack_scalar( buffer + done * bits / 8, end, count - done, bits, result + done ) ;
+				}
+			}
+		}
+	}
+}
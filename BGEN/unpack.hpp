@@ -0,0 +1,36 @@
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef GENFILE_BGEN_UNPACK_HPP
+#define GENFILE_BGEN_UNPACK_HPP
+
+#include <cstddef>
+#include "types.hpp"
+
+namespace genfile {
+	namespace bgen {
+		namespace v12 {
+			namespace impl {
+				// True if unpack_probabilities() supports the given number of bits (8, 10, 12 or 16).
+				bool can_unpack_probabilities( int const bits ) ;
+
+				// Decode count values of the given number of bits, packed least significant bit first
+				// from buffer, into result as probabilities value / (2^bits - 1).  The results are the
+				// same as those of read_bits_from_buffer() and parse_bit_representation().
+				// The kernel (AVX-512, AVX2 or scalar) is chosen once, at first use, from the CPU features.
+				// Throws a BGenError if the buffer is too short.
+				void unpack_probabilities(
+					byte_t const* buffer,
+					byte_t const* const end,
+					std::size_t const count,
+					int const bits,
+					double* result
+				) ;
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,42 @@
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "zstd.hpp"
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace genfile {
+#if HAVE_ZSTD
+	namespace impl {
+		struct ZstdContext {
+			ZstdContext(): m_context( ZSTD_createDCtx() ) {}
+			~ZstdContext() { ZSTD_freeDCtx( m_context ) ; }
+			ZSTD_DCtx* m_context ;
+		} ;
+	}
+
+	bool zstd_uncompress( unsigned char const* begin, unsigned char const* const end, std::vector< unsigned char >* dest ) {
+		static thread_local impl::ZstdContext context ;
+		if( context.m_context == 0 ) {
+			return false ;
+		}
+		std::size_t const result = ZSTD_decompressDCtx(
+			context.m_context,
+			&dest->operator[]( 0 ), dest->size(),
+			begin, end - begin
+		) ;
+		if( ZSTD_isError( result ) ) {
+			return false ;
+		}
+		dest->resize( result ) ;
+		return true ;
+	}
+#else
+	bool zstd_uncompress( unsigned char const*, unsigned char const* const, std::vector< unsigned char >* ) {
+		return false ;
+	}
+#endif
+}
@@ -0,0 +1,26 @@
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef GENFILE_ZSTD_HPP
+#define GENFILE_ZSTD_HPP
+
+#include <vector>
+#include <stdint.h>
+
+// Zstandard support needs the zstd library; build with -DHAVE_ZSTD and -lzstd.
+#ifndef HAVE_ZSTD
+#define HAVE_ZSTD 0
+#endif
+
+namespace genfile {
+	// Uncompress the zstd frame in [begin, end) into dest.
+	// The destination must be large enough to fit the uncompressed data,
+	// and it will be resized to exactly fit the uncompressed data.
+	// A decompression context is kept per thread and reused between calls.
+	// Returns false if the data could not be uncompressed (or zstd support is not built in).
+	bool zstd_uncompress( unsigned char const* begin, unsigned char const* const end, std::vector< unsigned char >* dest ) ;
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Allocator for vectors whose data starts on a cache line, so that columns
+// of numbers can be read with aligned vector loads
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#define CACHE_LINE 64
+
+template <class T>
+class alignedAllocator
+{
+public:
+    typedef T value_type;
+
+    alignedAllocator() {}
+    template <class U> alignedAllocator(const alignedAllocator <U> &) {}
+
+    T * allocate(size_t n)
+    {
+        return static_cast <T *> (::operator new(n * sizeof(T), std::align_val_t(CACHE_LINE)));
+    }
+    void deallocate(T * p, size_t)
+    {
+        ::operator delete(p, std::align_val_t(CACHE_LINE));
+    }
+
+    template <class U> bool operator==(const alignedAllocator <U> &) const {return true;}
+    template <class U> bool operator!=(const alignedAllocator <U> &) const {return false;}
+};
+
+typedef std::vector <double, alignedAllocator <double> > alignedDoubles;
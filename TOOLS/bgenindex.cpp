@@ -0,0 +1,223 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include "bgenindex.h"
+#include "mappedfile.h"
+
+using namespace std;
+
+#define BGEN_COMPRESSION 3          // flags: compression of the genotype data blocks
+#define BGEN_LAYOUT (15 << 2)       // flags: layout, 1 for v1.1 and 2 for v1.2
+#define BGEN_V11 (1 << 2)
+#define BGEN_V12 (2 << 2)
+
+static const char indexMagic[8] = {'S', 'C', 'O', 'P', 'A', 'I', 'D', 'X'};
+static const uint32_t indexVersion = 1;
+
+static inline uint64_t
+le(const unsigned char * p, int bytes)
+{
+    uint64_t x = 0;
+    for (int i = bytes - 1; i >= 0; i--) x = (x << 8) | p[i];
+    return x;
+}
+
+static void
+put(string & out, uint64_t x, int bytes)
+{
+    for (int i = 0; i < bytes; i++) out.push_back((char) ((x >> (8 * i)) & 255));
+}
+
+bgenIndex::bgenIndex():
+    _fileSize(0), _fileTime(0)
+{
+}
+
+bool
+bgenIndex::fileStamp(const string & bgenFile, uint64_t & size, uint64_t & time)
+{
+    struct stat st;
+    if (stat(bgenFile.c_str(), &st) != 0) return false;
+    size = st.st_size;
+    time = st.st_mtime;
+    return true;
+}
+
+bool
+bgenIndex::build(const string & bgenFile)
+{
+    _variants.clear();
+    _names.clear();
+    mappedFile F;
+    if (!fileStamp(bgenFile, _fileSize, _fileTime) || !F.open(bgenFile)) return false;
+    const unsigned char * data = (const unsigned char *) F.data();
+    size_t size = F.size();
+
+    // Offset of the first variant, header block and its flags
+    if (size < 24) return false;
+    uint64_t first = le(data, 4) + 4;
+    uint64_t headerLength = le(data + 4, 4);
+    if (headerLength < 20 || 4 + headerLength > size || first > size) return false;
+    uint32_t samples = (uint32_t) le(data + 12, 4);
+    uint32_t flags = (uint32_t) le(data + headerLength, 4);
+    uint32_t layout = flags & BGEN_LAYOUT;
+    if (layout != BGEN_V11 && layout != BGEN_V12) return false;
+
+    F.sequential();
+    size_t p = first;
+    while (p < size)
+    {
+        entry E;
+        E.offset = p;
+        if (layout == BGEN_V11) p += 4;
+
+        // ids, chromosome and position
+        size_t field[3];
+        uint16_t length[3];
+        int order[3] = {2, 1, 0};   // SNPID, rsid, chromosome as stored; kept as chromosome, rsid, SNPID
+        for (int i = 0; i < 3; i++)
+        {
+            if (p + 2 > size) return false;
+            length[order[i]] = (uint16_t) le(data + p, 2);
+            field[order[i]] = p + 2;
+            p += 2 + length[order[i]];
+        }
+        if (p + 4 > size) return false;
+        E.position = (uint32_t) le(data + p, 4);
+        p += 4;
+
+        // alleles
+        uint64_t alleles = 2;
+        if (layout == BGEN_V12)
+        {
+            if (p + 2 > size) return false;
+            alleles = le(data + p, 2);
+            p += 2;
+        }
+        for (uint64_t a = 0; a < alleles; a++)
+        {
+            if (p + 4 > size) return false;
+            p += 4 + le(data + p, 4);
+        }
+
+        // genotype data block
+        uint64_t block = 6 * (uint64_t) samples;
+        if (layout == BGEN_V12 || (flags & BGEN_COMPRESSION))
+        {
+            if (p + 4 > size) return false;
+            block = le(data + p, 4);
+            p += 4;
+        }
+        if (p + block > size) return false;
+        p += block;
+
+        E.names = _names.size();
+        E.chromosome = length[0];
+        E.rsid = length[1];
+        E.SNPID = length[2];
+        for (int i = 0; i < 3; i++) _names.append((const char *) data + field[i], length[i]);
+        _variants.push_back(E);
+    }
+    return true;
+}
+
+bool
+bgenIndex::save(const string & bgenFile) const
+{
+    string out(indexMagic, sizeof(indexMagic));
+    put(out, indexVersion, 4);
+    put(out, _fileSize, 8);
+    put(out, _fileTime, 8);
+    put(out, _variants.size(), 8);
+    for (size_t i = 0; i < _variants.size(); i++)
+    {
+        const entry & E = _variants[i];
+        put(out, E.offset, 8);
+        put(out, E.position, 4);
+        const char * s = &_names[0] + E.names;
+        put(out, E.chromosome, 2);
+        out.append(s, E.chromosome);
+        put(out, E.rsid, 2);
+        out.append(s + E.chromosome, E.rsid);
+        put(out, E.SNPID, 2);
+        out.append(s + E.chromosome + E.rsid, E.SNPID);
+    }
+
+    // Written next to the final name and renamed, so a reader never sees half an index
+    string name = fileName(bgenFile), temporary = name + ".tmp";
+    FILE * f = fopen(temporary.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    if (fclose(f) != 0) ok = false;
+    if (ok && rename(temporary.c_str(), name.c_str()) == 0) return true;
+    remove(temporary.c_str());
+    return false;
+}
+
+bool
+bgenIndex::load(const string & bgenFile)
+{
+    _variants.clear();
+    _names.clear();
+    uint64_t fileSize, fileTime;
+    mappedFile F;
+    if (!fileStamp(bgenFile, fileSize, fileTime) || !F.open(fileName(bgenFile))) return false;
+    const unsigned char * data = (const unsigned char *) F.data();
+    size_t size = F.size();
+    if (size < 36 || memcmp(data, indexMagic, sizeof(indexMagic)) != 0 || le(data + 8, 4) != indexVersion) return false;
+    _fileSize = le(data + 12, 8);
+    _fileTime = le(data + 20, 8);
+    if (_fileSize != fileSize || _fileTime != fileTime) return false;
+    uint64_t count = le(data + 28, 8);
+    if (count > size / 20) return false;
+    _variants.reserve(count);
+
+    size_t p = 36;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        entry E;
+        if (p + 12 > size) break;
+        E.offset = le(data + p, 8);
+        E.position = (uint32_t) le(data + p + 8, 4);
+        p += 12;
+        E.names = _names.size();
+        uint16_t * length[3] = {&E.chromosome, &E.rsid, &E.SNPID};
+        int j = 0;
+        for (; j < 3 && p + 2 <= size; j++)
+        {
+            *length[j] = (uint16_t) le(data + p, 2);
+            if (p + 2 + *length[j] > size) break;
+            _names.append((const char *) data + p + 2, *length[j]);
+            p += 2 + *length[j];
+        }
+        if (j < 3) break;
+        _variants.push_back(E);
+    }
+    if (_variants.size() != count || p != size)
+    {
+        _variants.clear();
+        _names.clear();
+        return false;
+    }
+    return true;
+}
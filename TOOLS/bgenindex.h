@@ -0,0 +1,81 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Variant index of a BGEN file (v1.1 and v1.2 layouts): chromosome, position,
+// rsid and SNPID of every variant with the file offset of its data, kept in a
+// sidecar file <file.bgen>.scopaidx. The index is built by reading only the
+// variant headers, skipping the genotype data blocks, and is rebuilt when the
+// size or modification time of the BGEN file no longer matches.
+//
+//   sidecar:  char[8]  "SCOPAIDX" and format version 1
+//             uint64   size and modification time of the BGEN file, number of variants
+//   variant:  uint64   offset of the variant in the BGEN file
+//             uint32   position
+//             3 times  uint16 length + characters: chromosome, rsid, SNPID
+//
+// Numbers are little endian, as written by x86 and ARM.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+class bgenIndex
+{
+public:
+    bgenIndex();
+    static std::string fileName(const std::string & bgenFile) {return bgenFile + ".scopaidx";}
+
+    bool load(const std::string & bgenFile);        // false if there is no index or it is out of date
+    bool build(const std::string & bgenFile);       // false if the file is not a v1.1/v1.2 BGEN file or is corrupt
+    bool save(const std::string & bgenFile) const;  // false if the sidecar cannot be written
+    size_t size() const {return _variants.size();}
+
+    // Offsets, in file order, of the variants for which wanted(chromosome, position, rsid, SNPID) holds
+    template <class predicate>
+    void select(predicate wanted, std::vector <uint64_t> & offsets) const
+    {
+        offsets.clear();
+        for (size_t i = 0; i < _variants.size(); i++)
+        {
+            const entry & E = _variants[i];
+            const char * s = &_names[0] + E.names;
+            std::string_view chromosome(s, E.chromosome), rsid(s + E.chromosome, E.rsid), SNPID(s + E.chromosome + E.rsid, E.SNPID);
+            if (wanted(chromosome, E.position, rsid, SNPID)) offsets.push_back(E.offset);
+        }
+    }
+
+private:
+    struct entry
+    {
+        uint64_t offset;
+        uint64_t names;             // chromosome, rsid and SNPID back to back in _names
+        uint32_t position;
+        uint16_t chromosome, rsid, SNPID;   // lengths
+    };
+    std::vector <entry> _variants;
+    std::string _names;
+    uint64_t _fileSize;
+    uint64_t _fileTime;
+
+    static bool fileStamp(const std::string & bgenFile, uint64_t & size, uint64_t & time);
+};
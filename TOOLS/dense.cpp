@@ -0,0 +1,115 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "dense.h"
+
+using namespace std;
+
+#define DENSE_BLOCK 4               // rows of X added to X'X in one pass over it
+
+void
+denseMatrix::resize(int rows, int cols)
+{
+    if (rows <= 0 || cols <= 0) rows = cols = 0;
+    _rows = rows;
+    _cols = cols;
+    _data.assign((size_t) rows * cols, 0);
+}
+
+void
+crossProduct(const denseMatrix & X, const double * w, denseMatrix & XtX)
+{
+    int M = X.rows();
+    int N = X.cols();
+    XtX.resize(N, N);
+    double * __restrict S = XtX.data();
+
+    // Upper triangle, DENSE_BLOCK rows of X at a time
+    int k = 0;
+    for (; k + DENSE_BLOCK <= M; k += DENSE_BLOCK)
+    {
+        const double * __restrict x0 = X.row(k).data();
+        const double * __restrict x1 = x0 + N;
+        const double * __restrict x2 = x1 + N;
+        const double * __restrict x3 = x2 + N;
+        double w0 = w ? w[k] : 1, w1 = w ? w[k+1] : 1, w2 = w ? w[k+2] : 1, w3 = w ? w[k+3] : 1;
+        for (int i = 0; i < N; i++)
+        {
+            double a0 = w0 * x0[i], a1 = w1 * x1[i], a2 = w2 * x2[i], a3 = w3 * x3[i];
+            double * __restrict Si = S + (size_t) i * N;
+            for (int j = i; j < N; j++) Si[j] += a0 * x0[j] + a1 * x1[j] + a2 * x2[j] + a3 * x3[j];
+        }
+    }
+    for (; k < M; k++)
+    {
+        const double * __restrict x = X.row(k).data();
+        double wk = w ? w[k] : 1;
+        for (int i = 0; i < N; i++)
+        {
+            double a = wk * x[i];
+            double * __restrict Si = S + (size_t) i * N;
+            for (int j = i; j < N; j++) Si[j] += a * x[j];
+        }
+    }
+    for (int i = 1; i < N; i++)
+        for (int j = 0; j < i; j++) S[(size_t) i * N + j] = S[(size_t) j * N + i];
+}
+
+void
+transposeTimes(const denseMatrix & X, const double * w, const double * y, double * Xty)
+{
+    int M = X.rows();
+    int N = X.cols();
+    double * __restrict out = Xty;
+    for (int j = 0; j < N; j++) out[j] = 0;
+    for (int k = 0; k < M; k++)
+    {
+        const double * __restrict x = X.row(k).data();
+        double a = w ? w[k] * y[k] : y[k];
+        for (int j = 0; j < N; j++) out[j] += a * x[j];
+    }
+}
+
+void
+times(const denseMatrix & X, const double * b, double * Xb)
+{
+    int M = X.rows();
+    int N = X.cols();
+    for (int k = 0; k < M; k++)
+    {
+        const double * __restrict x = X.row(k).data();
+        double t = 0;
+        for (int j = 0; j < N; j++) t += b[j] * x[j];
+        Xb[k] = t;
+    }
+}
+
+double
+residualSS(const double * y, const double * yhat, const double * w, int n, double * dy)
+{
+    double RSS = 0;
+    for (int k = 0; k < n; k++)
+    {
+        double d = yhat[k] - y[k];
+        if (dy) dy[k] = d;
+        RSS += (w ? w[k] : 1) * d * d;
+    }
+    return RSS;
+}
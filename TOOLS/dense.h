@@ -0,0 +1,98 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Dense row-major matrices on cache line aligned storage, with the kernels
+// the regressions are built from. Elements are read and written without
+// bounds checks, and the kernels run over contiguous rows so that their
+// inner loops vectorise. matrixD and arrayD keep their checked get/put on
+// top of these types.
+
+#pragma once
+
+#include "aligned.h"
+
+// Contiguous run of elements, as std::span
+template <class T>
+class denseSpan
+{
+public:
+    denseSpan(T * p, int n): _p(p), _n(n) {}
+    T & operator[](int i) const {return _p[i];}
+    T * data() const {return _p;}
+    int size() const {return _n;}
+    T * begin() const {return _p;}
+    T * end() const {return _p + _n;}
+
+private:
+    T * _p;
+    int _n;
+};
+
+// Column of a row-major matrix: elements are a row length apart
+template <class T>
+class denseColumn
+{
+public:
+    denseColumn(T * p, int n, int stride): _p(p), _n(n), _stride(stride) {}
+    T & operator[](int i) const {return _p[(size_t) i * _stride];}
+    int size() const {return _n;}
+
+private:
+    T * _p;
+    int _n;
+    int _stride;
+};
+
+class denseMatrix
+{
+public:
+    denseMatrix(int rows = 0, int cols = 0): _rows(0), _cols(0) {resize(rows, cols);}
+    void resize(int rows, int cols);    // all elements 0, memory is kept
+    int rows() const {return _rows;}
+    int cols() const {return _cols;}
+    int size() const {return _rows * _cols;}
+    double * data() {return _data.data();}
+    const double * data() const {return _data.data();}
+    double & operator()(int i, int j) {return _data[(size_t) i * _cols + j];}
+    double operator()(int i, int j) const {return _data[(size_t) i * _cols + j];}
+    denseSpan <double> row(int i) {return denseSpan <double> (data() + (size_t) i * _cols, _cols);}
+    denseSpan <const double> row(int i) const {return denseSpan <const double> (data() + (size_t) i * _cols, _cols);}
+    denseColumn <double> column(int j) {return denseColumn <double> (data() + j, _rows, _cols);}
+    denseColumn <const double> column(int j) const {return denseColumn <const double> (data() + j, _rows, _cols);}
+
+private:
+    alignedDoubles _data;
+    int _rows;
+    int _cols;
+};
+
+// Kernels; a null weight vector w means all weights are 1
+
+// XtX = X' diag(w) X
+void crossProduct(const denseMatrix & X, const double * w, denseMatrix & XtX);
+
+// Xty = X' diag(w) y
+void transposeTimes(const denseMatrix & X, const double * w, const double * y, double * Xty);
+
+// Xb = X b, the fitted values of coefficients b
+void times(const denseMatrix & X, const double * b, double * Xb);
+
+// Weighted sum of squared residuals yhat - y, residuals are stored in dy if given
+double residualSS(const double * y, const double * yhat, const double * w, int n, double * dy);
@@ -0,0 +1,63 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include <charconv>
+#include <stdlib.h>
+#include "genline.h"
+
+using namespace std;
+
+static inline bool
+isDelimiter(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+int
+genLine::parse(const char * p, const char * end, int leading)
+{
+    fields.clear();
+    probs.clear();
+    int n = 0;
+    while (true)
+    {
+        while (p < end && isDelimiter(*p)) p++;
+        if (p == end) break;
+        const char * start = p;
+        if (n < leading)
+        {
+            while (p < end && !isDelimiter(*p)) p++;
+            fields.push_back(string_view(start, p - start));
+        }
+        else
+        {
+            double x = 0;
+            from_chars_result r = from_chars(p, end, x);
+            p = r.ptr;
+            while (p < end && !isDelimiter(*p)) p++;
+            // a field from_chars rejects ('+1', out of range) or reads only in part ('0x1p3'
+            // stops at the 'x') is read as atof would
+            if (r.ec != errc() || r.ptr != p) x = atof(string(start, p).c_str());
+            probs.push_back(x);
+        }
+        n++;
+    }
+    return n;
+}
@@ -0,0 +1,54 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include <charconv>
+#include "genomicrange.h"
+
+using namespace std;
+
+string_view
+genomicRange::normalise(string_view chr)
+{
+    if (chr.size() > 3 && (chr.substr(0, 3) == "chr" || chr.substr(0, 3) == "CHR")) chr.remove_prefix(3);
+    while (chr.size() > 1 && chr[0] == '0') chr.remove_prefix(1);
+    return chr;
+}
+
+bool
+genomicRange::parse(const string & text)
+{
+    size_t colon = text.rfind(':');
+    if (colon == string::npos || colon == 0) return false;
+    chromosome = string(normalise(string_view(text).substr(0, colon)));
+
+    const char * p = text.data() + colon + 1;
+    const char * last = text.data() + text.size();
+    from_chars_result r = from_chars(p, last, start);
+    if (r.ec != errc() || r.ptr == p) return false;
+    end = start;
+    if (r.ptr != last)
+    {
+        if (*r.ptr != '-') return false;
+        p = r.ptr + 1;
+        r = from_chars(p, last, end);
+        if (r.ec != errc() || r.ptr == p || r.ptr != last) return false;
+    }
+    return start <= end;
+}
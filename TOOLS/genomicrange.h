@@ -0,0 +1,44 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Chromosome region chr:start-end (or chr:position) given with --range.
+// Chromosome names are compared without a "chr" prefix and leading zeros,
+// so 1, 01 and chr1 are the same chromosome, and X the same as 0X.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <stdint.h>
+
+class genomicRange
+{
+public:
+    std::string chromosome;         // normalised
+    uint32_t start;
+    uint32_t end;                   // inclusive
+
+    bool parse(const std::string & text);   // false if text is not chr:start-end or chr:position
+    bool contains(std::string_view chr, uint32_t position) const
+    {
+        return position >= start && position <= end && normalise(chr) == chromosome;
+    }
+    static std::string_view normalise(std::string_view chr);
+};
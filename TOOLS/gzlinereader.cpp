@@ -0,0 +1,322 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include "gzlinereader.h"
+
+using namespace std;
+
+#define GZ_BUFFER (4 << 20)         // characters inflated per buffer of a gzip file
+#define BGZF_BATCH 64               // BGZF blocks (up to 64 kB each) inflated per buffer
+#define BGZF_AHEAD 2                // buffers inflated ahead of the reader per BGZF thread
+
+static inline uint32_t
+le16(const unsigned char * p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t
+le32(const unsigned char * p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+// Size of the BGZF block starting at p, or 0 if there is no complete block:
+// a gzip member with extra subfield 'BC' holding the block size minus one
+static size_t
+bgzfBlockSize(const unsigned char * p, size_t available)
+{
+    if (available < 18 || p[0] != 31 || p[1] != 139 || p[2] != 8 || !(p[3] & 4)) return 0;
+    size_t extra = 12 + le16(p + 10);
+    if (available < extra) return 0;
+    for (size_t i = 12; i + 4 <= extra; i += 4 + le16(p + i + 2))
+    {
+        if (p[i] == 'B' && p[i + 1] == 'C' && le16(p + i + 2) == 2 && i + 6 <= extra)
+        {
+            size_t size = le16(p + i + 4) + 1;
+            return size <= available && size >= extra + 8 ? size : 0;
+        }
+    }
+    return 0;
+}
+
+gzLineReader::gzLineReader():
+    _file(0), _bgzf(false), _cursor(0), _claimed(0), _consumed(0), _ahead(0),
+    _done(true), _stop(false), _error(false), _pos(0), _carryReturned(false)
+{
+}
+
+gzLineReader::~gzLineReader()
+{
+    close();
+}
+
+void
+gzLineReader::close()
+{
+    {
+        unique_lock <mutex> L(_lock);
+        _stop = true;
+    }
+    _hasRoom.notify_all();
+    for (int i = 0; i < _workers.size(); i++) _workers[i].join();
+    _workers.clear();
+    if (_file) gzclose(_file);
+    _file = 0;
+    _map.close();
+    _ready.clear();
+    _current.clear();
+    _carry.clear();
+}
+
+bool
+gzLineReader::open(const string & filename, int threads)
+{
+    close();
+    _cursor = 0;
+    _claimed = _consumed = 0;
+    _done = _stop = false;
+    _error = false;
+    _pos = 0;
+    _carryReturned = false;
+
+    _bgzf = _map.open(filename) && bgzfBlockSize((const unsigned char *) _map.data(), _map.size()) > 0;
+    if (_bgzf)
+    {
+        _map.sequential();
+        int n = max(1, threads);
+        _ahead = (long) BGZF_AHEAD * n;
+        for (int i = 0; i < n; i++) _workers.push_back(thread(&gzLineReader::inflateBGZF, this));
+        return true;
+    }
+    _map.close();
+    _file = gzopen(filename.c_str(), "r");
+    if (!_file)
+    {
+        _done = true;
+        return false;
+    }
+    gzbuffer(_file, 1 << 20);
+    _ahead = 2;
+    _workers.push_back(thread(&gzLineReader::inflateGzip, this));
+    return true;
+}
+
+bool
+gzLineReader::next(const char ** begin, const char ** end)
+{
+    if (_carryReturned)
+    {
+        _carry.clear();
+        _carryReturned = false;
+    }
+    while (true)
+    {
+        if (_pos < _current.size())
+        {
+            const char * data = _current.data();
+            const char * eol = (const char *) memchr(data + _pos, '\n', _current.size() - _pos);
+            if (eol)
+            {
+                if (_carry.empty())
+                {
+                    *begin = data + _pos;
+                    *end = eol;
+                }
+                else
+                {
+                    _carry.append(data + _pos, eol);
+                    *begin = _carry.data();
+                    *end = _carry.data() + _carry.size();
+                    _carryReturned = true;
+                }
+                _pos = eol - data + 1;
+                return true;
+            }
+            _carry.append(data + _pos, data + _current.size());
+            _pos = _current.size();
+        }
+        if (!take())
+        {
+            if (_carry.empty() || _error) return false;
+            *begin = _carry.data();         // last line without line end
+            *end = _carry.data() + _carry.size();
+            _carryReturned = true;
+            return true;
+        }
+    }
+}
+
+// Gives the current buffer back and waits for the next one in file order
+bool
+gzLineReader::take()
+{
+    unique_lock <mutex> L(_lock);
+    if (_current.capacity() && _free.size() < _ahead)
+    {
+        _free.push_back(vector <char> ());
+        _free.back().swap(_current);
+    }
+    _current.clear();
+    _pos = 0;
+    _hasData.wait(L, [this]{return _ready.count(_consumed) || (_done && _consumed >= _claimed);});
+    map <long, vector <char> >::iterator it = _ready.find(_consumed);
+    if (it == _ready.end()) return false;
+    _current.swap(it->second);
+    _ready.erase(it);
+    _consumed++;
+    _hasRoom.notify_all();
+    return true;
+}
+
+void
+gzLineReader::give(long id, vector <char> & buffer)
+{
+    unique_lock <mutex> L(_lock);
+    _ready[id].swap(buffer);
+    _hasData.notify_one();
+}
+
+vector <char>
+gzLineReader::recycled()
+{
+    vector <char> buffer;
+    unique_lock <mutex> L(_lock);
+    if (!_free.empty())
+    {
+        buffer.swap(_free.back());
+        _free.pop_back();
+    }
+    return buffer;
+}
+
+// Plain gzip: one thread inflates the stream in order
+void
+gzLineReader::inflateGzip()
+{
+    while (true)
+    {
+        long id;
+        {
+            unique_lock <mutex> L(_lock);
+            _hasRoom.wait(L, [this]{return _stop || _claimed - _consumed < _ahead;});
+            if (_stop) return;
+            id = _claimed++;
+        }
+        vector <char> buffer = recycled();
+        buffer.resize(GZ_BUFFER);
+        int got = gzread(_file, buffer.data(), GZ_BUFFER);
+        if (got <= 0)
+        {
+            int status;
+            gzerror(_file, &status);        // a truncated file ends with Z_BUF_ERROR
+            unique_lock <mutex> L(_lock);
+            if (got < 0 || status != Z_OK) _error = true;
+            _claimed = id;
+            _done = true;
+            _hasData.notify_all();
+            return;
+        }
+        buffer.resize(got);
+        give(id, buffer);
+    }
+}
+
+// BGZF: every thread takes the next batch of blocks and inflates it on its own
+void
+gzLineReader::inflateBGZF()
+{
+    const unsigned char * data = (const unsigned char *) _map.data();
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    inflateInit2(&z, -15);          // raw deflate data, the gzip framing is read here
+    vector <size_t> blocks;
+
+    while (true)
+    {
+        long id;
+        blocks.clear();
+        {
+            unique_lock <mutex> L(_lock);
+            _hasRoom.wait(L, [this]{return _stop || _done || _claimed - _consumed < _ahead;});
+            if (_stop || _done) break;
+            while (blocks.size() < BGZF_BATCH && _cursor < _map.size())
+            {
+                size_t size = bgzfBlockSize(data + _cursor, _map.size() - _cursor);
+                if (!size)
+                {
+                    _error = true;
+                    break;
+                }
+                blocks.push_back(_cursor);
+                _cursor += size;
+            }
+            blocks.push_back(_cursor);
+            if (_error || _cursor >= _map.size()) _done = true;
+            if (blocks.size() == 1 || _error)
+            {
+                _hasData.notify_all();
+                _hasRoom.notify_all();
+                break;
+            }
+            id = _claimed++;
+        }
+
+        size_t total = 0;
+        for (size_t k = 0; k + 1 < blocks.size(); k++) total += le32(data + blocks[k + 1] - 4);
+        vector <char> buffer = recycled();
+        buffer.resize(total);
+
+        char * out = buffer.data();
+        char none;
+        bool ok = true;
+        for (size_t k = 0; ok && k + 1 < blocks.size(); k++)
+        {
+            const unsigned char * p = data + blocks[k];
+            size_t size = blocks[k + 1] - blocks[k];
+            size_t extra = 12 + le16(p + 10);
+            uint32_t length = le32(p + size - 4);
+            inflateReset(&z);
+            z.next_in = (Bytef *) p + extra;
+            z.avail_in = size - extra - 8;
+            z.next_out = length ? (Bytef *) out : (Bytef *) &none;
+            z.avail_out = length;
+            ok = inflate(&z, Z_FINISH) == Z_STREAM_END && z.avail_out == 0
+                && crc32(0, (Bytef *) out, length) == le32(p + size - 8);
+            out += length;
+        }
+        if (!ok)
+        {
+            // nothing from this buffer on is read
+            unique_lock <mutex> L(_lock);
+            _error = true;
+            _done = true;
+            _claimed = min(_claimed, id);
+            _hasData.notify_all();
+            _hasRoom.notify_all();
+            break;
+        }
+        give(id, buffer);
+    }
+    inflateEnd(&z);
+}
@@ -0,0 +1,91 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Reads the lines of a gzipped (or plain) text file. Inflating runs on
+// background threads ahead of the caller, which gets a line as a range of an
+// internal buffer, valid until the next call.
+//
+// BGZF files (bgzip output) consist of independent gzip blocks of at most
+// 64 kB, so batches of blocks are inflated in parallel by several threads.
+// Any other file is inflated by a single thread with zlib, double buffered
+// ahead of the caller. Lines spanning two buffers are reassembled, so lines
+// can be of any length.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#include "mappedfile.h"
+
+class gzLineReader
+{
+public:
+    gzLineReader();
+    ~gzLineReader();
+    bool open(const std::string & filename, int threads = 1);  // false if the file cannot be opened
+    bool next(const char ** begin, const char ** end);         // false at end of file or on error
+    bool error() const {return _error;}                         // file is corrupt or truncated
+    bool isBGZF() const {return _bgzf;}
+
+private:
+    gzLineReader(const gzLineReader &);
+    gzLineReader & operator=(const gzLineReader &);
+
+    // plain gzip
+    gzFile _file;
+
+    // BGZF: blocks are read from the mapped file
+    mappedFile _map;
+    bool _bgzf;
+    size_t _cursor;                         // start of the next block not yet given to a worker
+
+    // inflated buffers, in file order
+    std::vector <std::thread> _workers;
+    std::mutex _lock;
+    std::condition_variable _hasData;
+    std::condition_variable _hasRoom;
+    std::map <long, std::vector <char> > _ready;
+    std::vector <std::vector <char> > _free;    // buffers given back by the reader, for reuse
+    long _claimed;                          // buffers being or already inflated
+    long _consumed;                         // buffers taken by the reader
+    long _ahead;                            // buffers inflated ahead of the reader
+    bool _done;                             // no more buffers after _claimed
+    bool _stop;
+    std::atomic <bool> _error;
+
+    // reader side
+    std::vector <char> _current;            // buffer lines are read from
+    size_t _pos;                            // first unread character in _current
+    std::string _carry;                     // start of a line continued in the next buffer
+    bool _carryReturned;
+
+    void close();
+    bool take();
+    void give(long id, std::vector <char> & buffer);
+    std::vector <char> recycled();
+    void inflateGzip();
+    void inflateBGZF();
+};
@@ -0,0 +1,90 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include <functional>
+#include "idset.h"
+
+using namespace std;
+
+idSet::idSet():
+    _slots(16), _count(0)
+{
+    for (size_t i = 0; i < _slots.size(); i++) _slots[i].offset = EMPTY;
+}
+
+uint64_t
+idSet::hashOf(string_view id)
+{
+    return hash <string_view>()(id);
+}
+
+size_t
+idSet::find(string_view id, uint64_t h) const
+{
+    size_t mask = _slots.size() - 1;
+    uint32_t tag = (uint32_t) (h >> 32);
+    for (size_t i = h & mask; ; i = (i + 1) & mask)
+    {
+        const slot & S = _slots[i];
+        if (S.offset == EMPTY) return i;
+        if (S.hash == tag && S.length == id.size() && _arena.compare(S.offset, S.length, id) == 0) return i;
+    }
+}
+
+void
+idSet::insert(string_view id)
+{
+    uint64_t h = hashOf(id);
+    size_t i = find(id, h);
+    if (_slots[i].offset != EMPTY) return;
+
+    slot & S = _slots[i];
+    S.offset = _arena.size();
+    S.length = (uint32_t) id.size();
+    S.hash = (uint32_t) (h >> 32);
+    _arena.append(id.data(), id.size());
+    _count++;
+    if (2 * _count > _slots.size()) grow();
+}
+
+bool
+idSet::contains(string_view id) const
+{
+    if (_count == 0) return false;
+    return _slots[find(id, hashOf(id))].offset != EMPTY;
+}
+
+void
+idSet::grow()
+{
+    vector <slot> old;
+    old.swap(_slots);
+    slot free = {EMPTY, 0, 0};
+    _slots.assign(2 * old.size(), free);
+    size_t mask = _slots.size() - 1;
+    for (size_t j = 0; j < old.size(); j++)
+    {
+        if (old[j].offset == EMPTY) continue;
+        string_view id(_arena.data() + old[j].offset, old[j].length);
+        size_t i = hashOf(id) & mask;
+        while (_slots[i].offset != EMPTY) i = (i + 1) & mask;
+        _slots[i] = old[j];
+    }
+}
@@ -0,0 +1,58 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Set of marker identifiers for inclusion/exclusion lists. The identifiers are
+// stored back to back in one string arena and found through an open addressing
+// hash table of offsets, so a list of tens of millions of markers takes about
+// the size of its text plus 16 bytes per slot, with no allocation per marker.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+class idSet
+{
+public:
+    idSet();
+    void insert(std::string_view id);
+    bool contains(std::string_view id) const;
+    size_t size() const {return _count;}
+    bool empty() const {return _count == 0;}
+
+private:
+    struct slot
+    {
+        uint64_t offset;            // start of the identifier in _arena, EMPTY if slot is free
+        uint32_t length;
+        uint32_t hash;              // upper bits of the hash, to skip most string compares
+    };
+    static const uint64_t EMPTY = ~(uint64_t) 0;
+
+    std::string _arena;
+    std::vector <slot> _slots;      // size is a power of two, at most half full
+    size_t _count;
+
+    static uint64_t hashOf(std::string_view id);
+    size_t find(std::string_view id, uint64_t h) const;    // slot of id, or the free slot where it belongs
+    void grow();
+};
@@ -0,0 +1,95 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mappedfile.h"
+
+using namespace std;
+
+mappedFile::mappedFile():
+    _fd(-1), _data(0), _size(0)
+{
+}
+
+mappedFile::~mappedFile()
+{
+    close();
+}
+
+bool
+mappedFile::open(const string & filename)
+{
+    close();
+    _fd = ::open(filename.c_str(), O_RDONLY);
+    if (_fd < 0) return false;
+
+    struct stat st;
+    if (fstat(_fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        close();
+        return false;
+    }
+    void * p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (p == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+    _data = (char *) p;
+    _size = st.st_size;
+    return true;
+}
+
+void
+mappedFile::close()
+{
+    if (_data) munmap(_data, _size);
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+    _data = 0;
+    _size = 0;
+}
+
+void
+mappedFile::sequential()
+{
+    advise(0, _size, MADV_SEQUENTIAL);
+}
+
+void
+mappedFile::willNeed(size_t offset, size_t length)
+{
+    advise(offset, length, MADV_WILLNEED);
+}
+
+void
+mappedFile::advise(size_t offset, size_t length, int advice)
+{
+    if (!_data || offset >= _size) return;
+    if (length > _size - offset) length = _size - offset;
+
+    // madvise needs a page aligned start address
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t start = offset - offset % page;
+    madvise(_data + start, length + (offset - start), advice);
+}
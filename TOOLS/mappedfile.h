@@ -0,0 +1,52 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Read-only memory mapping of an input file, so that parsers can work on the
+// file contents in place instead of copying them through a stream.
+
+#pragma once
+
+#include <string>
+#include <stddef.h>
+
+class mappedFile
+{
+public:
+    mappedFile();
+    ~mappedFile();
+    bool open(const std::string & filename);    // false if the file cannot be mapped (missing, empty, pipe)
+    void close();
+    bool isOpen() const {return _data != 0;}
+    const char * data() const {return _data;}
+    size_t size() const {return _size;}
+
+    void sequential();                          // hint: whole file will be read front to back
+    void willNeed(size_t offset, size_t length);// hint: start reading this range in ahead of use
+
+private:
+    mappedFile(const mappedFile &);
+    mappedFile & operator=(const mappedFile &);
+
+    int _fd;
+    char * _data;
+    size_t _size;
+
+    void advise(size_t offset, size_t length, int advice);
+};
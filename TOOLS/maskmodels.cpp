@@ -0,0 +1,263 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include <math.h>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <map>
+#include "maskmodels.h"
+#include "simd.h"
+#include "solver.h"
+#include "tools.h"
+
+using namespace std;
+
+static string
+join(const vector <string> & names, const string & separator)
+{
+    string s;
+    for (int i = 0; i < names.size(); i++)
+    {
+        if (i) s += separator;
+        s += names[i];
+    }
+    return s;
+}
+
+// Samples having every phenotype of the mask
+int
+maskModels::count(const maskModel & M) const
+{
+    int words = (_sampleCount + 63) / 64;
+    int n = 0;
+    for (int w = 0; w < words; w++)
+    {
+        uint64_t bits = ~(uint64_t) 0;
+        for (int z = 0; z < M.phenoCount; z++) bits &= _table->presence(M.phenos[z])[w];
+        n += __builtin_popcountll(bits);
+    }
+    return n;
+}
+
+bool
+maskModels::init(const phenotypeTable & table, const vector <string> & names)
+{
+    _table = &table;
+    _phenoCount = table.phenoCount();
+    _sampleCount = table.sampleCount();
+    int P1 = _phenoCount + 1;
+    _stride = simdKernels::stride(P1);
+    _rows.assign((size_t) _sampleCount * _stride, 0);
+    _pattern.resize(_sampleCount);
+    _patterns.clear();
+    _patternXtX.clear();
+
+    // Group samples by missingness pattern and sum [1, phenotypes] cross-products per pattern
+    map <unsigned int, int> patternIndex;
+    for (int k = 0; k < _sampleCount; k++)
+    {
+        unsigned int present = 0;
+        for (int j = 0; j < _phenoCount; j++) if (table.present(j, k)) present |= 1u << (_phenoCount-1-j);
+        map <unsigned int, int>::iterator it = patternIndex.find(present);
+        if (it == patternIndex.end())
+        {
+            it = patternIndex.insert(make_pair(present, (int) _patterns.size())).first;
+            _patterns.push_back(present);
+            _patternXtX.resize(_patterns.size() * P1 * P1, 0);
+        }
+        int p = it->second;
+        _pattern[k] = p;
+
+        double * x = &_rows[(size_t) k * _stride];
+        x[0] = 1.0;
+        for (int j = 0; j < _phenoCount; j++) x[j+1] = table.column(j)[k];
+        double * XtX = &_patternXtX[p * P1 * P1];
+        for (int i = 0; i < P1; i++)
+            for (int j = 0; j < P1; j++)
+                XtX[i*P1+j] += x[i] * x[j];
+    }
+
+    int _testcount = pow(2, _phenoCount);
+    models.clear();
+    for (int test = _testcount-1; test >= 1; test--)
+    {
+        maskModel M;
+        M.test = test;
+        M.phenoMask = phenoMasker(test, _phenoCount);
+        for (int j = 0; j < _phenoCount; j++) if (M.phenoMask[j]) M.phenos.push_back(j);
+        M.phenoCount = (int) M.phenos.size();
+        M.sampleCount = 0;
+        vector <string> sorted;
+        for (int z = 0; z < M.phenoCount; z++) sorted.push_back(names[M.phenos[z]]);
+        M.model = join(sorted, "+");
+        sort(sorted.begin(), sorted.end());
+        M.sortedModel = join(sorted, "+");
+
+        // Least squares matrix of the mask is the sum over compatible patterns
+        int N = M.phenoCount + 1;
+        vector <int> & col = M.columns;
+        col.resize(N);
+        col[0] = 0;
+        for (int z = 0; z < M.phenoCount; z++) col[z+1] = M.phenos[z] + 1;
+        M.XtX.assign(N*N, 0);
+        for (int p = 0; p < _patterns.size(); p++)
+        {
+            if ((_patterns[p] & (unsigned int) test) != (unsigned int) test) continue;
+            M.patterns.push_back(p);
+            const double * XtX = &_patternXtX[p * P1 * P1];
+            for (int i = 0; i < N; i++)
+                for (int j = 0; j < N; j++)
+                    M.XtX[i*N+j] += XtX[col[i]*P1+col[j]];
+        }
+        M.sampleCount = count(M);
+        ldltSolver <0> solver;
+        M.isOK = solver.factorise(&M.XtX[0], N);
+        M.rank = solver.rank;
+        M.condition = solver.condition;
+        if (M.isOK)
+        {
+            M.XtXinv.resize(N*N);
+            solver.inverse(&M.XtXinv[0]);
+        }
+        models.push_back(M);
+    }
+    return true;
+}
+
+void
+maskModels::accumulate(const vector <double> & dose, patternStats & S) const
+{
+    int patternCount = (int) _patterns.size();
+    S.Xty.assign(patternCount * _stride, 0);
+    S.YY.assign(patternCount, 0);
+
+    // missing phenotypes are 0 and their sums are never read by a compatible mask
+    simdKernels::accumulate(&_rows[0], _stride, &_pattern[0], &dose[0], _sampleCount, &S.Xty[0], &S.YY[0]);
+}
+
+// Fit with the number of linear terms a constant T, so that X'y, the
+// coefficients, their errors and covariance live in stack arrays, the loops
+// unroll and the results are copied out to F once; T = 0 is the fallback for
+// any number of terms, working in the buffers of F
+template <int T>
+bool
+maskModels::fit(const maskModel & M, const patternStats & S, maskFit & F) const
+{
+    const int N = T > 0 ? T : M.phenoCount + 1;    // Number of linear terms
+    const int * col = &M.columns[0];
+    int nind = M.sampleCount;       // Number of data points
+    F.rank = M.rank;
+    F.condition = M.condition;
+
+    int NDF = nind - N;             // Degrees of freedom
+    if (NDF < 1) return false;
+    if (!M.isOK) return false;
+
+    array <double, T> fixedB, fixedC, fixedSE;
+    array <double, T*T> fixedCov;
+    double * B = fixedB.data();
+    double * C = fixedC.data();
+    double * SE = fixedSE.data();
+    double * Cov = fixedCov.data();
+    if (T == 0)
+    {
+        F.B.resize(N);
+        F.Cstat.resize(N);
+        F.SECstat.resize(N);
+        F.covariance.resize(N*N);
+        B = &F.B[0];
+        C = &F.Cstat[0];
+        SE = &F.SECstat[0];
+        Cov = &F.covariance[0];
+    }
+
+    // X'y and y'y of the mask from the compatible patterns
+    for (int i = 0; i < N; i++) B[i] = 0;
+    double YY = 0;
+    for (int q = 0; q < M.patterns.size(); q++)
+    {
+        int p = M.patterns[q];
+        const double * Xty = &S.Xty[p * _stride];
+        for (int i = 0; i < N; i++) B[i] += Xty[col[i]];
+        YY += S.YY[p];
+    }
+
+    // X'X and its inverse were computed for the mask in init
+    const double * XtX = &M.XtX[0];
+    const double * V = &M.XtXinv[0];
+
+    // Coefficients C = VB
+    for (int i = 0; i < N; i++)
+    {
+        double c = 0;
+        for (int j = 0; j < N; j++) c = c + V[i*N+j] * B[j];
+        C[i] = c;
+    }
+
+    // Residual and total sums of squares from sufficient statistics
+    double YBAR = B[0] / nind;
+    double TSS = YY - nind * YBAR * YBAR;
+    double RSS = YY;
+    for (int i = 0; i < N; i++) RSS -= C[i] * B[i];
+    if (TSS < 0) TSS = 0;
+    if (RSS < 0) RSS = 0;
+    double SSQ = RSS / NDF;
+    double VarG = TSS / (nind - 1);
+
+    // var/covar matrix, std errors and the inverted var/covar matrix
+    for (int i = 0; i < N; i++)
+    {
+        SE[i] = sqrt(V[i*N+i] * SSQ);
+        for (int j = 0; j < N; j++) Cov[i*N+j] = XtX[i*N+j] / SSQ;
+    }
+
+    F.sampleCount = nind;
+    if (T > 0)
+    {
+        F.Cstat.assign(C, C + N);
+        F.SECstat.assign(SE, SE + N);
+        F.covariance.assign(Cov, Cov + N*N);
+    }
+
+    // log-likelihoods of the model and of the null (intercept only) model
+    double sigma = sqrt(SSQ);
+    F.testLogLikelihood = -(RSS/(2*sigma*sigma) + nind*log(sigma));
+    double sigma0 = sqrt(VarG);
+    F.nullLogLikelihood = -(TSS/(2*sigma0*sigma0) + nind*log(sigma0));
+    return true;
+}
+
+bool
+maskModels::fit(const maskModel & M, const patternStats & S, maskFit & F) const
+{
+    switch (M.phenoCount + 1)
+    {
+    case 2: return fit <2> (M, S, F);
+    case 3: return fit <3> (M, S, F);
+    case 4: return fit <4> (M, S, F);
+    case 5: return fit <5> (M, S, F);
+    case 6: return fit <6> (M, S, F);
+    case 7: return fit <7> (M, S, F);
+    case 8: return fit <8> (M, S, F);
+    case 9: return fit <9> (M, S, F);
+    default: return fit <0> (M, S, F);
+    }
+}
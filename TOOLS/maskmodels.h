@@ -0,0 +1,114 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Reverse regression of genotype dosage on every subset (mask) of phenotypes.
+// Design matrix X = [1, phenotypes in mask] depends only on the sample file,
+// so X'X and its inverse are computed once per mask at startup. For each
+// variant only X'y and y'y are accumulated and the fit statistics of lr::lr_w,
+// lr::getLnLk and lr::nullLikelihood are derived from them.
+//
+// Samples are grouped by their phenotype missingness pattern. A mask uses
+// every pattern that has all of its phenotypes present, so the sums over the
+// samples of a mask are sums of per-pattern sums and the samples are scanned
+// once per variant, not once per mask. The samples of a mask (and their
+// number) are the AND of the presence bitmaps of its phenotypes, counted
+// word by word once at startup.
+//
+// There is no dosage bitmap: no genotype reader marks a dosage as missing.
+// A sample without genotype data is kept at dose 0, as SCOPA always did, so
+// the samples and X'X of a mask are the same for every variant.
+//
+// The phenotypes are copied once into rows [1, phenotypes] padded to whole
+// cache lines, so the per-variant pass adds each sample's row times its
+// dosage with the vector kernels of simd.h.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "aligned.h"
+#include "structures.h"
+#include "../sample.h"
+
+class maskModel
+{
+public:
+    int test;                       // mask number, as used by phenoMasker
+    vector <bool> phenoMask;
+    vector <int> phenos;            // indices of phenotypes in model
+    vector <int> columns;           // of the linear terms in [1, phenotypes]: 0, phenos+1
+    int phenoCount;
+    string model;                   // phenotype names joined by '+', in file order
+    string sortedModel;             // the same, names sorted
+    int sampleCount;                // samples with all phenotypes of the mask present
+    bool isOK;                      // false if X'X is not of full rank
+    int rank;                       // numerical rank of X'X
+    double condition;               // estimated condition number of X'X (see solver.h)
+    vector <int> patterns;          // missingness patterns compatible with the mask
+    vector <double> XtX;            // raw least squares matrix, (phenoCount+1)^2
+    vector <double> XtXinv;         // inverted least squares matrix
+};
+
+class maskFit
+{
+public:
+    int sampleCount;
+    vector <double> Cstat;          // Coefficients
+    vector <double> SECstat;        // Std Error of coefficients
+    vector <double> covariance;     // inverted var/covar matrix of coefficients
+    double testLogLikelihood;
+    double nullLogLikelihood;
+    int rank;                       // numerical rank of the X'X fitted, less than the terms if collinear
+    double condition;               // its estimated condition number
+
+    vector <double> B;              // X'y of maskModels::fit for models of more than 9 terms
+};
+
+// Dosage part of the cross-product matrix [1, phenotypes, dosage] of one
+// variant, summed per missingness pattern
+class patternStats
+{
+public:
+    alignedDoubles Xty;             // patterns x row stride: sum of y, sum of x*y
+    vector <double> YY;             // sum of y*y
+};
+
+class maskModels
+{
+private:
+    int _phenoCount;
+    int _sampleCount;
+    const phenotypeTable * _table;
+    vector <unsigned int> _patterns;// distinct sets of non-missing phenotypes (same bit order as test)
+    vector <int> _pattern;          // per sample: index into _patterns
+    int _stride;                    // phenotypes+1 rounded up to SIMD_ROW
+    alignedDoubles _rows;           // samples x _stride: 1, phenotypes (0 if missing), 0 padding
+    vector <double> _patternXtX;    // patterns x (phenotypes+1)^2, cross-products of [1, phenotypes]
+
+    int count(const maskModel & M) const;
+    template <int T> bool fit(const maskModel & M, const patternStats & S, maskFit & F) const;
+
+public:
+    vector <maskModel> models;      // from model with all phenotypes down to single phenotype models
+    bool init(const phenotypeTable & table, const vector <string> & names);
+    void accumulate(const vector <double> & dose, patternStats & S) const;
+    bool fit(const maskModel & M, const patternStats & S, maskFit & F) const;
+};
@@ -0,0 +1,313 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include <cstring>
+#include <stdint.h>
+#include <zlib.h>
+#ifndef HAVE_ZSTD
+#define HAVE_ZSTD 0
+#endif
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "outputfile.h"
+
+using namespace std;
+
+#define OUTPUT_BLOCK (1 << 20)      // bytes collected before a block is written or compressed
+#define BGZF_INPUT 0xff00           // bytes per BGZF block, as bgzip
+#define BGZF_MAX 0x10000            // largest BGZF block
+#define ZSTD_LEVEL 3
+
+// gzip header with extra subfield 'BC' holding the block size minus one (bytes 16 and 17)
+static const unsigned char bgzfHeader[18] = {31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0, 0, 0};
+
+// empty block marking the end of a BGZF file
+static const unsigned char bgzfEOF[28] = {31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0, 27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+static inline void
+put16(unsigned char * p, uint32_t x)
+{
+    p[0] = x & 255;
+    p[1] = (x >> 8) & 255;
+}
+
+static inline void
+put32(unsigned char * p, uint32_t x)
+{
+    put16(p, x);
+    put16(p + 2, x >> 16);
+}
+
+// Appends data as BGZF blocks to out; a block that does not shrink is stored
+static bool
+bgzfCompress(z_stream & Z, const char * data, size_t size, vector <char> & out)
+{
+    for (size_t done = 0; done < size; done += BGZF_INPUT)
+    {
+        uInt n = (uInt) min((size_t) BGZF_INPUT, size - done);
+        size_t start = out.size();
+        out.resize(start + BGZF_MAX);
+        unsigned char * p = (unsigned char *) &out[start];
+        memcpy(p, bgzfHeader, 18);
+
+        if (deflateReset(&Z) != Z_OK) return false;
+        Z.next_in = (Bytef *) (data + done);
+        Z.avail_in = n;
+        Z.next_out = p + 18;
+        Z.avail_out = BGZF_MAX - 26;
+        size_t deflated;
+        if (deflate(&Z, Z_FINISH) == Z_STREAM_END) deflated = Z.total_out;
+        else
+        {
+            p[18] = 1;              // final stored block
+            put16(p + 19, n);
+            put16(p + 21, ~n);
+            memcpy(p + 23, data + done, n);
+            deflated = n + 5;
+        }
+        put32(p + 18 + deflated, crc32(crc32(0, Z_NULL, 0), (const Bytef *) (data + done), n));
+        put32(p + 22 + deflated, n);
+        put16(p + 16, (uint32_t) (deflated + 25));
+        out.resize(start + deflated + 26);
+    }
+    return true;
+}
+
+outputFile::outputFile():
+    std::ostream(0)
+{
+    rdbuf(&_buffer);
+    setstate(badbit);
+}
+
+outputFile::~outputFile()
+{
+    close();
+}
+
+bool
+outputFile::open(const string & filename, compression type, int threads)
+{
+    if (is_open() || !available(type) || !_buffer.open(filename, type, threads))
+    {
+        setstate(failbit);
+        return false;
+    }
+    clear();
+    return true;
+}
+
+bool
+outputFile::close()
+{
+    if (!is_open()) return true;
+    bool ok = _buffer.close();
+    if (!ok) setstate(badbit);
+    return ok;
+}
+
+bool
+outputFile::available(compression type)
+{
+    return type != ZSTD || HAVE_ZSTD;
+}
+
+const char *
+outputFile::extension(compression type)
+{
+    if (type == GZIP) return ".gz";
+    if (type == ZSTD) return ".zst";
+    return "";
+}
+
+outputFile::blockBuffer::blockBuffer():
+    _file(0), _type(PLAIN), _submitted(0), _written(0), _ahead(0), _writing(false), _stop(false), _error(false)
+{
+}
+
+bool
+outputFile::blockBuffer::open(const string & filename, compression type, int threads)
+{
+    _file = fopen(filename.c_str(), "wb");
+    if (!_file) return false;
+    _type = type;
+    _submitted = _written = 0;
+    _writing = false;
+    _stop = false;
+    _error = false;
+    _block.resize(OUTPUT_BLOCK);
+    setp(&_block[0], &_block[0] + _block.size());
+    if (_type != PLAIN)
+    {
+        if (threads < 1) threads = 1;
+        _ahead = 2 * threads + 1;
+        for (int i = 0; i < threads; i++) _workers.push_back(thread(&blockBuffer::worker, this));
+    }
+    return true;
+}
+
+bool
+outputFile::blockBuffer::close()
+{
+    bool ok = submit();
+    {
+        unique_lock <mutex> L(_lock);
+        _stop = true;
+    }
+    _hasWork.notify_all();
+    for (int i = 0; i < _workers.size(); i++) _workers[i].join();
+    _workers.clear();
+    if (_type == GZIP && fwrite(bgzfEOF, 1, sizeof(bgzfEOF), _file) != sizeof(bgzfEOF)) ok = false;
+    if (fclose(_file) != 0) ok = false;
+    _file = 0;
+    setp(0, 0);
+    _block.clear();
+    _free.clear();
+    return ok && !_error;
+}
+
+outputFile::blockBuffer::int_type
+outputFile::blockBuffer::overflow(int_type c)
+{
+    if (!_file || !submit()) return traits_type::eof();
+    if (c != traits_type::eof())
+    {
+        *pptr() = (char) c;
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int
+outputFile::blockBuffer::sync()
+{
+    if (!_file) return -1;
+    if (_type != PLAIN) return _error ? -1 : 0;
+    bool ok = submit();
+    if (fflush(_file) != 0) ok = false;
+    return ok && !_error ? 0 : -1;
+}
+
+bool
+outputFile::blockBuffer::submit()
+{
+    size_t n = pptr() - pbase();
+    if (n > 0)
+    {
+        if (_type == PLAIN)
+        {
+            if (fwrite(pbase(), 1, n, _file) != n) _error = true;
+        }
+        else
+        {
+            unique_lock <mutex> L(_lock);
+            _hasRoom.wait(L, [this]{return _submitted - _written < _ahead;});
+            _block.resize(n);
+            _input.push_back(make_pair(_submitted++, vector <char> ()));
+            _input.back().second.swap(_block);
+            if (!_free.empty())
+            {
+                _block.swap(_free.back());
+                _free.pop_back();
+            }
+            _hasWork.notify_one();
+        }
+        _block.resize(OUTPUT_BLOCK);
+        setp(&_block[0], &_block[0] + _block.size());
+    }
+    return !_error;
+}
+
+void
+outputFile::blockBuffer::worker()
+{
+    z_stream Z;
+    memset(&Z, 0, sizeof(Z));
+    if (_type == GZIP && deflateInit2(&Z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) _error = true;
+#if HAVE_ZSTD
+    ZSTD_CCtx * C = _type == ZSTD ? ZSTD_createCCtx() : 0;
+    if (_type == ZSTD && !C) _error = true;
+#endif
+
+    while (true)
+    {
+        long id;
+        vector <char> in, out;
+        {
+            unique_lock <mutex> L(_lock);
+            _hasWork.wait(L, [this]{return _stop || !_input.empty();});
+            if (_input.empty()) break;
+            id = _input.front().first;
+            in.swap(_input.front().second);
+            _input.pop_front();
+        }
+
+        bool ok = !_error;
+        if (ok && _type == GZIP) ok = bgzfCompress(Z, &in[0], in.size(), out);
+#if HAVE_ZSTD
+        if (ok && _type == ZSTD)
+        {
+            out.resize(ZSTD_compressBound(in.size()));
+            size_t size = ZSTD_compressCCtx(C, &out[0], out.size(), &in[0], in.size(), ZSTD_LEVEL);
+            if (ZSTD_isError(size)) ok = false;
+            else out.resize(size);
+        }
+#endif
+
+        unique_lock <mutex> L(_lock);
+        if (!ok) _error = true;
+        _free.push_back(vector <char> ());
+        _free.back().swap(in);
+        _ready[id].swap(out);
+        if (_writing) continue;     // the worker writing takes this block too
+
+        // Write every compressed block that is next in file order, without holding the lock
+        _writing = true;
+        vector <vector <char> > blocks;
+        while (true)
+        {
+            map <long, vector <char> >::iterator it;
+            while ((it = _ready.find(_written + (long) blocks.size())) != _ready.end())
+            {
+                blocks.push_back(vector <char> ());
+                blocks.back().swap(it->second);
+                _ready.erase(it);
+            }
+            if (blocks.empty()) break;
+            L.unlock();
+            for (int i = 0; i < blocks.size(); i++)
+            {
+                vector <char> & B = blocks[i];
+                if (!_error && fwrite(&B[0], 1, B.size(), _file) != B.size()) _error = true;
+            }
+            L.lock();
+            _written += blocks.size();
+            blocks.clear();
+            _hasRoom.notify_all();
+        }
+        _writing = false;
+    }
+
+    if (_type == GZIP) deflateEnd(&Z);
+#if HAVE_ZSTD
+    if (C) ZSTD_freeCCtx(C);
+#endif
+}
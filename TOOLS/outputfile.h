@@ -0,0 +1,103 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Output file written through an ostream, plain or compressed. Written text
+// is collected in blocks of 1 MB; a compressed file hands every full block to
+// background threads, which compress blocks in parallel and append them to
+// the file in order, so the thread writing the stream only copies bytes. The
+// compressed blocks are written outside the lock, by one worker at a time, so
+// a slow disk delays the stream only when all blocks ahead are in use.
+//
+//   GZIP: BGZF (as written by bgzip), a series of gzip blocks of at most 64 kB
+//         that any gzip reader decompresses and that can be indexed by tabix.
+//   ZSTD: one zstd frame per block (needs SCOPA compiled with make ZSTD=1).
+//
+// flush() writes a plain file out, so a log file written with endl stays
+// readable while the program runs. A compressed file is cut into blocks only
+// when they are full or at close(), so flush() does not wait for the workers
+// and endl does not make tiny blocks.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+class outputFile : public std::ostream
+{
+public:
+    enum compression {PLAIN, GZIP, ZSTD};
+
+    outputFile();
+    ~outputFile();
+    bool open(const std::string & filename, compression type = PLAIN, int threads = 1);  // false if the file cannot be created
+    bool close();                           // false if anything could not be written
+    bool is_open() const {return _buffer._file != 0;}
+
+    static bool available(compression type);            // ZSTD only if compiled in
+    static const char * extension(compression type);    // "", ".gz" or ".zst"
+
+private:
+    outputFile(const outputFile &);
+    outputFile & operator=(const outputFile &);
+
+    class blockBuffer : public std::streambuf
+    {
+    public:
+        blockBuffer();
+        bool open(const std::string & filename, compression type, int threads);
+        bool close();
+        FILE * _file;
+
+    protected:
+        int_type overflow(int_type c);
+        int sync();
+
+    private:
+        compression _type;
+        std::vector <char> _block;          // put area
+        std::vector <std::thread> _workers;
+        std::mutex _lock;
+        std::condition_variable _hasWork;
+        std::condition_variable _hasRoom;   // also signalled when a block was written
+        std::deque <std::pair <long, std::vector <char> > > _input;
+        std::map <long, std::vector <char> > _ready;    // compressed, waiting for earlier blocks
+        std::vector <std::vector <char> > _free;        // written blocks, for reuse as put area
+        long _submitted;
+        long _written;
+        long _ahead;                        // blocks submitted ahead of the file
+        bool _writing;                      // a worker is writing blocks to the file
+        bool _stop;
+        std::atomic <bool> _error;
+
+        bool submit();                      // hands the put area over to the workers
+        void worker();
+    };
+
+    blockBuffer _buffer;
+};
@@ -30,28 +30,11 @@ double mabs(double x){if (x>0) return x; return x*-1.0;} // absolut value for do
 
 
 using namespace std;
-bool
-multip(matrixD & a,
-		matrixD * b, matrixD & c)                        // matrix multiplication
+
+lr::lr():
+    RYSQ(0), SDV(0), FReg(0), VarG(0), YBAR(0), isLogistic(false),
+    Cstat(&_Cstat), SECstat(&_SECstat), covariance(&_covariance)
 {
-  int ar = a.getRows();
-  int br = b->getRows();
-  if (ar == 0 || br == 0)
-    return false;
-  int ac = a.getCols();
-  int bc = b->getCols();
-  if ( ac != br )
-    return false;
-  
-//  int cr = ar;
-//  int cc = bc;
-  
-  for (int i = 0; i < ar; i++)
-    for (int j = 0; j < bc; j++)
-      for (int k = 0; k < ac; k++)
-	c.put(i,j, c.get(i,j) + a.get(i,k) * b->get(k,j));
-
-  return true;
 }
 
 bool
@@ -69,19 +52,14 @@ lr::lr_w(arrayD * Y, matrixD * X, arrayD * W)
     // Y[j]   = j-th observed data point
     // X[i,j] = j-th value of the i-th independent varialble
     // W[j]   = j-th weight value
-	isC = false;
-	isSEC = false;
-	isV = false;
-	isYcalc = false;
-	isDY = false;
     isLogistic = false;
 
     int M = Y->size();             // M = Number of data points
     int N = X->size() / M;         // N = Number of linear terms
     int NDF = M - N;			  // Degrees of freedom
-	Ycalc = new arrayD(M); isYcalc = true;
+	Ycalc.resize(M);
 
-	DY = new arrayD(M); isDY = true;
+	DY.resize(M);
 
     // If not enough data, don't attempt regression
     if (NDF < 1)
@@ -89,67 +67,41 @@ lr::lr_w(arrayD * Y, matrixD * X, arrayD * W)
         return false;
     }
 
-	V= new matrixD(N,N); isV = true;
-	Cstat= new arrayD(N); isC = true;
-	SECstat= new arrayD(N); isSEC = true;
-	arrayD B(N);   // Vector for LSQ
+	V.resize(N,N);
+	Cstat->resize(N);
+	SECstat->resize(N);
+	B.resize(N);   // Vector for LSQ
+	const denseMatrix & x = X->dense();
+	const double * y = Y->data();
+	const double * w = W->data();
 
     // Form Least Squares Matrix
-//	double z1, z2;
-    for (int i = 0; i < N; i++)
-    {
-        for (int j = 0; j < N; j++)
-        {
-			V->put(i,j,0);
-            for (int k = 0; k < M; k++)
-			{
-                V->put(i, j, (V->get(i,j) + W->get(k) * X->get(k, i) * X->get(k, j)));
-//				 z2 = W->get(k) * X->get(k, i) * X->get(k, j);
-//				 z1 = V->get(i,j);
-			}
-        }
-        B.put(i,0);
-        for (int k = 0; k < M; k++)
-			B.put(i, B.get(i) + W->get(k) * X->get(k, i) * Y->get(k));
-    }
+	crossProduct(x, w, V.dense());
+	transposeTimes(x, w, y, B.data());
 
     // V now contains the raw least squares matrix
-    if (!V->InvertS())
+    if (!solver.factorise(V.dense().data(), N))
     {
-        delete V;
-        delete Cstat;
-        delete SECstat;
         return false;
     }
-    // V now contains the inverted least square matrix
-    // Matrix multpily to get coefficients C = VB
-    for (int i = 0; i < N; i++)
-    {
-        Cstat->put(i, 0);
-        for (int j = 0; j < N; j++)
-            Cstat->put(i, (Cstat->get(i) + V->get(i, j) * B.get(j)));
-    }
+    // Coefficients C = inverse(V) B from the factors, then V is the inverted least square matrix
+    solver.solve(B.data(), Cstat->data());
+    solver.inverse(V.dense().data());
 
     // Calculate statistics
     double TSS = 0;
-    double RSS = 0;
     YBAR = 0;
     double WSUM = 0;
     for (int k = 0; k < M; k++)
     {
-        YBAR = YBAR + W->get(k) * Y->get(k);
-        WSUM = WSUM + W->get(k);
+        YBAR = YBAR + w[k] * y[k];
+        WSUM = WSUM + w[k];
     }
     YBAR = YBAR / WSUM;
     for (int k = 0; k < M; k++)
-    {
-        Ycalc->put(k, 0);
-        for (int i = 0; i < N; i++)
-            Ycalc->put(k, Ycalc->get(k) + Cstat->get(i) * X->get(k, i));
-        DY->put(k, Ycalc->get(k) - Y->get(k));
-        TSS = TSS + W->get(k) * (Y->get(k) - YBAR) * (Y->get(k) - YBAR);
-        RSS = RSS + W->get(k) * DY->get(k) * DY->get(k);
-    }
+        TSS = TSS + w[k] * (y[k] - YBAR) * (y[k] - YBAR);
+    times(x, Cstat->data(), Ycalc.data());
+    double RSS = residualSS(y, Ycalc.data(), w, M, DY.data());
     double SSQ = RSS / NDF;
     RYSQ = 1 - RSS / TSS;
     FReg = 9999999;
@@ -159,21 +111,21 @@ lr::lr_w(arrayD * Y, matrixD * X, arrayD * W)
 
     VarG = TSS/(M-1);
     
-    covariance = new matrixD(N,N);
+    covariance->resize(N,N);
     
     // Calculate var-covar matrix and std error of coefficients
+    denseMatrix & C = covariance->dense();
     for (int i = 0; i < N; i++)
     {
         for (int j = 0; j < N; j++)
         {
-            V->put(i, j, V->get(i, j) * SSQ);
-            covariance->put(i, j, V->get(i, j));
+            V.dense()(i, j) *= SSQ;
+            C(i, j) = V.dense()(i, j);
         }
-        // SECstat->put(i, sqrt(V->get(i, i)));
     }
     
     //lets try this
-    for (int i = 0; i < N; i++)SECstat->put(i, sqrt(covariance->get(i, i)));
+    for (int i = 0; i < N; i++) SECstat->data()[i] = sqrt(C(i, i));
 
     
     
@@ -189,11 +141,6 @@ lr::lg_w(arrayD * Y, matrixD * X, arrayD * W)
     // Y[j]   = j-th observed data point
     // X[i,j] = j-th value of the i-th independent varialble
     // W[j]   = j-th weight value
-	isC = false;
-	isSEC = false;
-	isV = false;
-	isYcalc = false;
-	isDY = false;
     isLogistic = true;
     
     int M = Y->size();             // M = Number of data points
@@ -207,15 +154,21 @@ lr::lg_w(arrayD * Y, matrixD * X, arrayD * W)
         return false;
     }
 
-	V= new matrixD(N,N); isV = true;
-	Cstat= new arrayD(N); isC = true;
-	SECstat= new arrayD(N); isSEC = true;
+	V.resize(N,N);
+	Cstat->resize(N);
+	SECstat->resize(N);
 
     
 	//START PLINK
 	
-	arrayD p(M);
-	arrayD V1(M);
+	p.resize(M);
+	V1.resize(M);
+	t3.resize(M);
+	ncoef.resize(N);
+	B.resize(N);
+	const denseMatrix & x = X->dense();
+	const double * y = Y->data();
+	const double * w = W->data();
 ///////////////////////////////////////
 // Newton-Raphson to fit logistic model.
 // Following code is edited version of PLINK
@@ -229,29 +182,17 @@ lr::lg_w(arrayD * Y, matrixD * X, arrayD * W)
       {
 	
 	// Determine p and V
+	times(x, Cstat->data(), p.data());
 	for (int i = 0; i < M; i++)
 	  {
-	    double t = 0;
-	    for (int j = 0; j < N; j++)
-	      t += Cstat->get(j) *  X->get(i,j);	    
-	    p.put(i, 1/(1+exp(-t)));
-		V1.put(i,  p.get(i) * (1 - p.get(i)));
+	    p.data()[i] = 1/(1+exp(-p.data()[i]));
+		V1.data()[i] = p.data()[i] * (1 - p.data()[i]);
 	  }
 	
 	// Update coefficients
 	// b <- b +  solve( t(X) %*% V %*% X ) %*% t(X) %*% ( y - p ) 
 	
-	matrixD T(N,N);
-
-	for (int j = 0; j < N; j++)
-	  for (int k = j; k < N; k++) 
-	    {
-	      double sum = 0;
-	      for (int i = 0; i < M; i++)
-				sum += X->get(i, j) * V1.get(i) *  X->get(i, k);
-	      T.put(j, k, sum);
-		  T.put(k, j, sum);	      
-	    }
+	crossProduct(x, V1.data(), T.dense());
 	if (!T.InvertS())
 	{
  //       delete V;
@@ -259,22 +200,12 @@ lr::lg_w(arrayD * Y, matrixD * X, arrayD * W)
  //       delete SECstat;
 		return false;
 	}
-	matrixD T2(N,M);
-	
-	// note implicit transpose of X
-	for (int i = 0; i < N; i++)
-	  for (int j = 0; j < M; j++)
-	    for (int k = 0; k < N; k++)
-	      T2.put(i, j, T2.get(i,j) + T.get(i, k) *  X->get(j, k));  
-		
-	arrayD t3(M);
 	for (int i = 0; i < M; i++) 
-	  t3.put(i,  (Y->get(i) - p.get(i))*W->get(i));
+	  t3.data()[i] = y[i] - p.data()[i];
 	
-	arrayD ncoef(N);
-	for (int j = 0; j < N; j++) 
-	  for (int i = 0; i < M; i++) 
-	    ncoef.put(j, ncoef.get(j) + T2.get(j, i) * t3.get(i));
+	// ncoef = T (X' W t3), without forming T X'
+	transposeTimes(x, w, t3.data(), B.data());
+	times(T.dense(), B.data(), ncoef.data());
 
 	// Update coefficients, and check for 
 	// convergence
@@ -294,19 +225,10 @@ lr::lg_w(arrayD * Y, matrixD * X, arrayD * W)
     /////////////////////////////////////////
     // Obtain covariance matrix of estimates
     // S <- solve( t(X) %*% V %*% X )        
-    // Transpose X and multiple by diagonal V
-    matrixD Xt(N,M);
+    // Weight X by diagonal V
     for (int i = 0; i < M; i++)
-      for (int j = 0; j < N; j++) 
-		Xt.put(j, i,  X->get(i,j)* V1.get(i)*W->get(i));
-	matrixD V2(N,N);
-	if (!multip(Xt, X, V2))
-	{
- //       delete V;
- //       delete Cstat;
- //       delete SECstat;
-		return false;
-	}
+		t3.data()[i] = V1.data()[i] * w[i];
+	crossProduct(x, t3.data(), V2.dense());
 	//end PLINK code
 
 	if (!V2.InvertS())
@@ -321,16 +243,9 @@ lr::lg_w(arrayD * Y, matrixD * X, arrayD * W)
     // Calculate var-covar matrix and std error of coefficients
     for (int i = 0; i < N; i++)
     {
-        SECstat->put(i, sqrt(V2.get(i, i)));
-    }
-    covariance = new matrixD(N,N);
-    for (int i = 0; i < N; i++)
-    {
-        for (int j = 0; j < N; j++)
-        {
-            covariance->put(i,j,V2.get(i,j));
-        }    
+        SECstat->data()[i] = sqrt(V2.dense()(i, i));
     }
+    covariance->dense() = V2.dense();
     return true;
 
 }
@@ -345,17 +260,15 @@ lr::getLnLk(arrayD * Y, matrixD * X, arrayD * W)
         // We assume the model is fit, and all Y's are either 0 or 1
         double lnlk = 0;
         int nind = Y->size();             // M = Number of data points
-        int np = X->size() / nind;         // N = Number of linear terms
-      //  cout << "INDS:" << nind << endl;
-      //  cout << "LINEAR TERMS:" << np << endl;
+        Ycalc.resize(nind);
+        times(X->dense(), Cstat->data(), Ycalc.data());
+        const double * fitted = Ycalc.data();
     if (isLogistic)
     {
         
         for (int i=0; i<nind; i++)                 
         {
-            double t = 0;
-            for (int j=0; j<np; j++)       
-                t += Cstat->get(j) * X->get(i, j);
+            double t = fitted[i];
             lnlk += Y->get(i) == 1 ? log( 1/(1+exp(-t))) : log(1 - (1/(1+exp(-t))) ); //logistic regression
             
         }                                
@@ -368,9 +281,7 @@ lr::getLnLk(arrayD * Y, matrixD * X, arrayD * W)
         double sigma = SDV;
         for (int i=0; i<nind; i++)
         {
-            double t = 0;
-            for (int j=0; j<np; j++)
-                t += Cstat->get(j) * X->get(i, j);
+            double t = fitted[i];
             lnlk +=
             -(
                ((Y->get(i)-t)*(Y->get(i)-t))/(2*sigma*sigma)+log(sigma)
@@ -422,21 +333,6 @@ lr::nullLikelihood (const vector<double>& COPYpheno)
 
 lr::~lr()
 {
-    if (isV == true)
-    {
-        delete V;
-        V= NULL;
-        delete Cstat;
-        Cstat = NULL;
-        delete SECstat;
-        SECstat = NULL;
-        delete covariance;      //not yet implemented in linear regression
-        covariance = NULL;
- 	delete Ycalc;  // added by Jani Heikkinen 20/05/2015
-	Ycalc = NULL;  // see 
-	delete DY;     // above
-	DY = NULL;     // this as well.
-    }
 }
 
 
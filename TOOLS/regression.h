@@ -23,23 +23,33 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "structures.h"
 
+// Results and working space are members, sized on every fit, so one lr
+// object fits any number of models without allocating once it is warm.
 class lr
 {
 
 private:
-	matrixD * V;			// Least squares and var/covar matrix
+	matrixD V;				// Least squares and var/covar matrix
 	double RYSQ;			// Multiple correlation coefficient
 	double SDV;				// Standard deviation of errors
 	double FReg;			// Fisher F statistic for regression
     double VarG;            // Variance of Y for linear regression null likelihood
     double YBAR;            // Defining YBAR
-	arrayD * Ycalc;			// Calculated values of Y
-	arrayD * DY;			// Residual values of Y
+	arrayD Ycalc;			// Calculated values of Y
+	arrayD DY;				// Residual values of Y
+	arrayD _Cstat, _SECstat;
+	matrixD _covariance;
+	arrayD B, p, V1, t3, ncoef;		// working space of lr_w and lg_w
+	matrixD T, V2;
+	ldltSolver <0> solver;	// of the least squares matrix of lr_w
 
-	bool isC, isSEC, isV, isYcalc, isDY, isLogistic, isCOV;
+	bool isLogistic;
 
+	lr(const lr &);
+	lr & operator=(const lr &);
 		
 public:
+	lr();
 	arrayD * Cstat;				// Coefficients	
 	arrayD * SECstat;			// Std Error of coefficients	
     matrixD * covariance;			//covar matrix  
@@ -48,6 +58,8 @@ public:
     double getLnLk(arrayD * Y, matrixD * X, arrayD * W); // Return -2 * sample log-likelihood
     const double nullLikelihood (const vector<double>& COPYpheno);
     double getFReg(){return FReg;}
+    int getRank(){return solver.rank;}					// of the least squares matrix of the last lr_w
+    double getCondition(){return solver.condition;}
 	~lr();
 };
 
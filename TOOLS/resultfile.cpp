@@ -0,0 +1,194 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include "resultfile.h"
+#include "textrow.h"
+
+using namespace std;
+
+static const char MAGIC[8] = {'S', 'C', 'O', 'P', 'A', 'R', 'B', 1};
+
+#define OUTPUT_BLOCK (1 << 20)          // text written per call by toText
+
+template <class T>
+static inline void
+put(string & block, T x)
+{
+    block.append((const char *) &x, sizeof(x));
+}
+
+static inline void
+putString(string & block, const string & s)
+{
+    uint16_t length = (uint16_t) min(s.size(), (size_t) 0xffff);
+    put(block, length);
+    block.append(s.data(), length);
+}
+
+string
+resultFile::textHeader(const vector <string> & phenoList, bool covariance)
+{
+    string text = "Chromosome\tPosition\tMarkerName\tEffectAllele\tOtherAllele\tInfoScore\tHWE\tMAF\tN\tAA\tAB\tBB\tPhenotypeCount\tMask\tLogLikelihood\tnullLogLikelihood\tLikelihoodRatio\tP-value\tBIC\tBICnull\tModel\tsortedModel";
+    textRow row(text);
+    if (covariance)
+    {
+        for (int i = 0; i < phenoList.size(); i++) row << "\tbeta_" << i+1 << "\tse_" << i+1;
+        for (int i = 0; i < phenoList.size(); i++)
+        {
+            for (int j = i; j < phenoList.size(); j++)
+                row << "\tcov_" << i+1 << "_" << j+1;
+        }
+    }
+    row << '\n';
+    return text;
+}
+
+void
+resultFile::writeHeader(ostream & OUT, const vector <string> & phenoList, bool covariance)
+{
+    string block(MAGIC, sizeof(MAGIC));
+    put(block, (uint32_t) (covariance ? 1 : 0));
+    put(block, (uint32_t) phenoList.size());
+    for (int i = 0; i < phenoList.size(); i++) putString(block, phenoList[i]);
+    OUT << block;
+}
+
+void
+resultFile::beginVariant(string & block, const variant & V, bool hweNA, double hwe)
+{
+    block.clear();
+    put(block, (int32_t) V.chr);
+    put(block, (int32_t) V.pos);
+    putString(block, V.markerName);
+    putString(block, V.effectAllele);
+    putString(block, V.nonEffectAllele);
+    put(block, V.infoscore);
+    put(block, hwe);
+    put(block, V.maf);
+    if (V.firstIsMajorAllele) {put(block, V.AA); put(block, V.aA); put(block, V.aa);}
+    else {put(block, V.aa); put(block, V.aA); put(block, V.AA);}
+    put(block, (uint8_t) (hweNA ? 1 : 0));
+    put(block, (uint32_t) 0);
+}
+
+void
+resultFile::addModel(string & block, uint32_t mask, int N, const double stats[6], const double * extra, int extraCount)
+{
+    put(block, mask);
+    put(block, (int32_t) N);
+    block.append((const char *) stats, 6 * sizeof(double));
+    block.append((const char *) extra, extraCount * sizeof(double));
+}
+
+void
+resultFile::endVariant(string & block, uint32_t rows)
+{
+    // block starts with the variant header, patch its row count
+    size_t at = 2 * sizeof(int32_t);
+    for (int i = 0; i < 3; i++)
+    {
+        uint16_t length;
+        memcpy(&length, &block[at], sizeof(length));
+        at += sizeof(length) + length;
+    }
+    at += 6 * sizeof(double) + 1;
+    memcpy(&block[at], &rows, sizeof(rows));
+}
+
+// Reads the next n bytes of the file, false at its end
+static bool
+get(istream & IN, void * p, size_t n)
+{
+    return (bool) IN.read((char *) p, n);
+}
+
+static bool
+getString(istream & IN, string & s)
+{
+    uint16_t length;
+    if (!get(IN, &length, sizeof(length))) return false;
+    s.resize(length);
+    return length == 0 || get(IN, &s[0], length);
+}
+
+bool
+resultFile::toText(istream & IN, ostream & OUT)
+{
+    char magic[sizeof(MAGIC)];
+    uint32_t flags, phenoCount;
+    if (!get(IN, magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) return false;
+    if (!get(IN, &flags, sizeof(flags)) || !get(IN, &phenoCount, sizeof(phenoCount)) || phenoCount > 32) return false;
+    bool covariance = flags & 1;
+    vector <string> phenoList(phenoCount);
+    for (int i = 0; i < phenoCount; i++) if (!getString(IN, phenoList[i])) return false;
+
+    string text = textHeader(phenoList, covariance);
+    string markerName, effectAllele, nonEffectAllele;
+    vector <double> extra;
+    int32_t chrPos[2];
+    while (get(IN, chrPos, sizeof(chrPos)))
+    {
+        double fields[6];               // info score, HWE, MAF, genotype counts
+        uint8_t hweNA;
+        uint32_t rows;
+        if (!getString(IN, markerName) || !getString(IN, effectAllele) || !getString(IN, nonEffectAllele)
+            || !get(IN, fields, sizeof(fields)) || !get(IN, &hweNA, sizeof(hweNA)) || !get(IN, &rows, sizeof(rows))) return false;
+        string hwe = hweNA ? string("NA") : textRow::format(fields[1]);
+
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            uint32_t mask;
+            int32_t N;
+            double stats[6];
+            if (!get(IN, &mask, sizeof(mask)) || !get(IN, &N, sizeof(N)) || !get(IN, stats, sizeof(stats))) return false;
+            int k = __builtin_popcount(mask);
+            if (covariance)
+            {
+                extra.resize(2 * k + k * (k + 1) / 2);
+                if (!get(IN, &extra[0], extra.size() * sizeof(double))) return false;
+            }
+
+            textRow row(text);
+            row << chrPos[0] << "\t" << chrPos[1] << "\t" << markerName << "\t" << effectAllele << "\t" << nonEffectAllele << "\t"
+                << fields[0] << "\t" << hwe << "\t" << fields[2] << "\t" << N << "\t"
+                << fields[3] << "\t" << fields[4] << "\t" << fields[5] << "\t" << k << "\t";
+            for (int i = 0; i < phenoCount; i++) row << ((mask >> i) & 1 ? "1" : "0");
+            for (int i = 0; i < 6; i++) row << "\t" << stats[i];
+            row << "\t";
+            vector <string> phenosorter;
+            for (int i = 0; i < phenoCount; i++) if ((mask >> i) & 1) phenosorter.push_back(phenoList[i]);
+            for (int i = 0; i < phenosorter.size(); i++) row << (i ? "+" : "") << phenosorter[i];
+            row << "\t";
+            sort(phenosorter.begin(), phenosorter.end());
+            for (int i = 0; i < phenosorter.size(); i++) row << (i ? "+" : "") << phenosorter[i];
+            if (covariance) for (int i = 0; i < extra.size(); i++) row << "\t" << extra[i];
+            row << '\n';
+        }
+        if (text.size() >= OUTPUT_BLOCK)
+        {
+            OUT << text;
+            text.clear();
+        }
+    }
+    OUT << text;
+    return IN.gcount() == 0 && (bool) OUT;      // file ends between variants
+}
@@ -0,0 +1,66 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Binary result file (.rbin), written instead of the text .result file with
+// --binary. Every field of a variant is stored once per variant, model rows
+// have fixed width columns and the Mask/Model/sortedModel strings are replaced
+// by a bit mask over the phenotype list stored in the header. SCOPA_CONVERT
+// turns the file back into the text of the .result file.
+//
+//   header:    char[8]  "SCOPARB" and format version 1
+//              uint32   flags (1: covariance columns)
+//              uint32   number of phenotypes, then every name as uint16 length + characters
+//   variant:   int32    chromosome, position
+//              3 times  uint16 length + characters: marker name, effect allele, other allele
+//              float64  info score, HWE p-value, MAF, AA, AB, BB (genotype counts in output order)
+//              uint8    1 if HWE is NA
+//              uint32   number of model rows
+//   model row: uint32   mask, bit i set if phenotype i is in the model
+//              int32    N
+//              float64  logLikelihood, nullLogLikelihood, likelihoodRatio, P-value, BIC, BICnull
+//              float64  with covariance: beta and se of the k phenotypes of the model, then
+//                       their k(k+1)/2 covariances (row by row, upper triangle)
+//
+// Numbers are little endian, as written by x86 and ARM.
+
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "../variant.h"
+
+class resultFile
+{
+public:
+    // Column names of the text .result file
+    static std::string textHeader(const std::vector <std::string> & phenoList, bool covariance);
+
+    // Writing: a variant block is built in a string and written when complete
+    static void writeHeader(std::ostream & OUT, const std::vector <std::string> & phenoList, bool covariance);
+    static void beginVariant(std::string & block, const variant & V, bool hweNA, double hwe);
+    static void addModel(std::string & block, uint32_t mask, int N, const double stats[6], const double * extra, int extraCount);
+    static void endVariant(std::string & block, uint32_t rows);
+
+    // Reading: converts a whole binary file to the text of the .result file; false if it is not valid
+    static bool toText(std::istream & IN, std::ostream & OUT);
+};
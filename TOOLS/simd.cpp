@@ -0,0 +1,141 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include <immintrin.h>
+#include "simd.h"
+
+using namespace std;
+
+// Every kernel keeps the order of the scalar code: y*y and row*y are
+// rounded products added to the sums one sample after the other.
+
+static void
+accumulateScalar(const double * rows, int stride, const int * pattern, const double * dose, int n,
+                 double * Xty, double * YY)
+{
+    for (int k = 0; k < n; k++)
+    {
+        double y = dose[k];
+        const double * x = rows + (size_t) k * stride;
+        double * acc = Xty + (size_t) pattern[k] * stride;
+        for (int j = 0; j < stride; j++) acc[j] += x[j] * y;
+        YY[pattern[k]] += y * y;
+    }
+}
+
+__attribute__((target("sse4.2")))
+static void
+accumulateSSE42(const double * rows, int stride, const int * pattern, const double * dose, int n,
+                double * Xty, double * YY)
+{
+    for (int k = 0; k < n; k++)
+    {
+        double y = dose[k];
+        const double * x = rows + (size_t) k * stride;
+        double * acc = Xty + (size_t) pattern[k] * stride;
+        __m128d Y = _mm_set1_pd(y);
+        for (int j = 0; j < stride; j += 2)
+            _mm_storeu_pd(acc + j, _mm_add_pd(_mm_loadu_pd(acc + j), _mm_mul_pd(_mm_load_pd(x + j), Y)));
+        YY[pattern[k]] += _mm_cvtsd_f64(_mm_mul_sd(Y, Y));
+    }
+}
+
+__attribute__((target("avx2")))
+static void
+accumulateAVX2(const double * rows, int stride, const int * pattern, const double * dose, int n,
+               double * Xty, double * YY)
+{
+    for (int k = 0; k < n; k++)
+    {
+        double y = dose[k];
+        const double * x = rows + (size_t) k * stride;
+        double * acc = Xty + (size_t) pattern[k] * stride;
+        __m256d Y = _mm256_set1_pd(y);
+        for (int j = 0; j < stride; j += 4)
+            _mm256_storeu_pd(acc + j, _mm256_add_pd(_mm256_loadu_pd(acc + j), _mm256_mul_pd(_mm256_load_pd(x + j), Y)));
+        YY[pattern[k]] += _mm_cvtsd_f64(_mm_mul_sd(_mm256_castpd256_pd128(Y), _mm256_castpd256_pd128(Y)));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void
+accumulateAVX512(const double * rows, int stride, const int * pattern, const double * dose, int n,
+                 double * Xty, double * YY)
+{
+    for (int k = 0; k < n; k++)
+    {
+        double y = dose[k];
+        const double * x = rows + (size_t) k * stride;
+        double * acc = Xty + (size_t) pattern[k] * stride;
+        __m512d Y = _mm512_set1_pd(y);
+        for (int j = 0; j < stride; j += 8)
+            _mm512_storeu_pd(acc + j, _mm512_add_pd(_mm512_loadu_pd(acc + j), _mm512_mul_pd(_mm512_load_pd(x + j), Y)));
+        YY[pattern[k]] += _mm_cvtsd_f64(_mm_mul_sd(_mm512_castpd512_pd128(Y), _mm512_castpd512_pd128(Y)));
+    }
+}
+
+simdKernels::level simdKernels::_level = simdKernels::SCALAR;
+simdKernels::accumulateKernel simdKernels::_accumulate = accumulateScalar;
+
+simdKernels::level
+simdKernels::detect()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return AVX512;
+    if (__builtin_cpu_supports("avx2")) return AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return SSE42;
+    return SCALAR;
+}
+
+bool
+simdKernels::select(const string & name)
+{
+    level best = detect();
+    level L;
+    if (name == "" || name == "auto") L = best;
+    else if (name == "scalar") L = SCALAR;
+    else if (name == "sse4.2" || name == "sse42") L = SSE42;
+    else if (name == "avx2") L = AVX2;
+    else if (name == "avx512") L = AVX512;
+    else return false;
+    if (L > best) return false;
+
+    _level = L;
+    if (L == AVX512) _accumulate = accumulateAVX512;
+    else if (L == AVX2) _accumulate = accumulateAVX2;
+    else if (L == SSE42) _accumulate = accumulateSSE42;
+    else _accumulate = accumulateScalar;
+    return true;
+}
+
+const char *
+simdKernels::name(level L)
+{
+    if (L == AVX512) return "avx512";
+    if (L == AVX2) return "avx2";
+    if (L == SSE42) return "sse4.2";
+    return "scalar";
+}
+
+int
+simdKernels::stride(int columns)
+{
+    return (columns + SIMD_ROW - 1) / SIMD_ROW * SIMD_ROW;
+}
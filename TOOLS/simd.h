@@ -0,0 +1,61 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Vector kernels of the per-variant sums, compiled for several instruction
+// sets into the same binary. The best set the CPU supports is chosen at
+// startup (or forced with --simd), so one build runs AVX-512 on Skylake
+// nodes and AVX2 on Zen nodes.
+//
+// A kernel adds one sample at a time to all sums of its row, lane by lane,
+// with separate multiplies and adds, so every element is summed in sample
+// order exactly as the scalar loop does and the results are the same on
+// every machine.
+
+#pragma once
+
+#include <string>
+
+#define SIMD_ROW 8                  // row strides are a multiple of this many doubles (one cache line)
+
+class simdKernels
+{
+public:
+    enum level {SCALAR, SSE42, AVX2, AVX512};
+
+    static level detect();                          // best level of this CPU
+    static bool select(const std::string & name);   // auto, scalar, sse4.2, avx2 or avx512; false if unknown or not supported
+    static level current() {return _level;}
+    static const char * name(level L);
+    static int stride(int columns);                 // columns rounded up to SIMD_ROW
+
+    // For every sample k < n:
+    //   Xty[pattern[k]*stride + j] += rows[k*stride + j] * dose[k] for j < stride
+    //   YY[pattern[k]] += dose[k] * dose[k]
+    static void accumulate(const double * rows, int stride, const int * pattern, const double * dose, int n,
+                           double * Xty, double * YY)
+    {
+        _accumulate(rows, stride, pattern, dose, n, Xty, YY);
+    }
+
+private:
+    typedef void (*accumulateKernel)(const double *, int, const int *, const double *, int, double *, double *);
+    static level _level;
+    static accumulateKernel _accumulate;
+};
@@ -0,0 +1,155 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Solver for the symmetric positive (semi-)definite least squares matrices
+// of the regressions. The matrix is scaled to unit diagonal and factorised
+//
+//   P S P' = L D L',  S = diag(s) A diag(s),  s_i = 1/sqrt(A_ii)
+//
+// with L unit lower triangular and the largest remaining diagonal element
+// chosen as the next pivot. A pivot of at most SOLVER_TOLERANCE ends the
+// factorisation: the remaining columns are (nearly) linear combinations of
+// the pivoted ones and the rank is the number of pivots taken. With the
+// default tolerance a full rank matrix has an estimated condition number of
+// at most about 1e10, so that solutions keep at least six correct digits.
+//
+// N > 0 fixes the size at compile time and keeps the factor on the stack,
+// N = 0 takes the size at run time and keeps its buffers between calls.
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define SOLVER_TOLERANCE 1e-10      // smallest pivot of the scaled matrix
+
+template <int N>
+class ldltSolver
+{
+public:
+    int rank;                       // numerical rank of A
+    double condition;               // of the scaled matrix, estimated by the largest/smallest pivot; inf if singular
+    double logDet;                  // log-determinant of A, if it has full rank
+
+    ldltSolver(): rank(0), condition(0), logDet(0), _n(N) {}
+
+    // Factorises the n x n row-major matrix A; false if it is not of full rank
+    bool factorise(const double * A, int n = N)
+    {
+        if (N > 0) n = N;
+        _n = n;
+        resize(n);
+        rank = 0;
+        condition = std::numeric_limits <double>::infinity();
+        logDet = 0;
+        for (int i = 0; i < n; i++)
+        {
+            // a zero column stays zero and is the last pivot
+            double a = A[i*n+i];
+            _s[i] = a > 0 ? 1 / std::sqrt(a) : 0;
+            _perm[i] = i;
+            logDet += std::log(a);
+        }
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++) _LD[i*n+j] = _s[i] * A[i*n+j] * _s[j];
+
+        double dmax = 0, dmin = 0;
+        for (int k = 0; k < n; k++)
+        {
+            int p = k;
+            for (int i = k + 1; i < n; i++) if (_LD[i*n+i] > _LD[p*n+p]) p = i;
+            if (p != k)
+            {
+                for (int j = 0; j < n; j++) std::swap(_LD[k*n+j], _LD[p*n+j]);
+                for (int i = 0; i < n; i++) std::swap(_LD[i*n+k], _LD[i*n+p]);
+                std::swap(_perm[k], _perm[p]);
+            }
+            double d = _LD[k*n+k];
+            if (!(d > SOLVER_TOLERANCE)) return false;
+            rank++;
+            if (k == 0 || d > dmax) dmax = d;
+            if (k == 0 || d < dmin) dmin = d;
+            logDet += std::log(d);
+            for (int i = k + 1; i < n; i++)
+            {
+                double l = _LD[i*n+k] / d;
+                for (int j = k + 1; j <= i; j++) _LD[i*n+j] -= l * _LD[j*n+k];
+                for (int j = k + 1; j < i; j++) _LD[j*n+i] = _LD[i*n+j];
+                _LD[k*n+i] = _LD[i*n+k];
+            }
+            for (int i = k + 1; i < n; i++) _LD[i*n+k] /= d;
+        }
+        condition = dmax / dmin;
+        return true;
+    }
+
+    // x = inverse(A) b, after a successful factorise; x may be b
+    void solve(const double * b, double * x)
+    {
+        int n = _n;
+        double * y = &_work[0];
+        for (int k = 0; k < n; k++) y[k] = _s[_perm[k]] * b[_perm[k]];
+        for (int k = 0; k < n; k++)
+            for (int j = 0; j < k; j++) y[k] -= _LD[k*n+j] * y[j];
+        for (int k = 0; k < n; k++) y[k] /= _LD[k*n+k];
+        for (int k = n - 1; k >= 0; k--)
+            for (int i = k + 1; i < n; i++) y[k] -= _LD[i*n+k] * y[i];
+        for (int k = 0; k < n; k++) x[_perm[k]] = _s[_perm[k]] * y[k];
+    }
+
+    // Ainv = inverse(A), row-major and exactly symmetric
+    void inverse(double * Ainv)
+    {
+        int n = _n;
+        for (int j = 0; j < n; j++)
+        {
+            for (int i = 0; i < n; i++) _column[i] = i == j;
+            solve(&_column[0], &_column[0]);
+            for (int i = j; i < n; i++) Ainv[i*n+j] = _column[i];
+        }
+        for (int i = 0; i < n; i++)
+            for (int j = i + 1; j < n; j++) Ainv[i*n+j] = Ainv[j*n+i];
+    }
+
+private:
+    template <class T, int S> using storage = typename std::conditional <N == 0, std::vector <T>, std::array <T, (N > 0 ? S : 1)> >::type;
+
+    int _n;
+    storage <double, N*N> _LD;      // L below, D on and L' above the diagonal of the scaled, permuted matrix
+    storage <double, N> _s;         // scaling
+    storage <int, N> _perm;         // k-th pivot is row _perm[k] of A
+    storage <double, N> _work, _column;
+
+    void resize(int n)
+    {
+        if constexpr (N == 0)
+        {
+            _LD.resize(n*n);
+            _s.resize(n);
+            _perm.resize(n);
+            _work.resize(n);
+            _column.resize(n);
+        }
+    }
+};
@@ -25,32 +25,30 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include "structures.h"
 
-double myabs(double x){if (x>0) return x; return x*-1.0;}
 
 
 
 using namespace std;
 
-matrixD::matrixD(int cRow, int cColumn)
+matrixD::matrixD(int cRow, int cColumn):
+	_D(cRow, cColumn)
 {
-//	cout << "Printing array " << cRow*cColumn << endl;
-    if (cRow>0 && cColumn>0)
-	{
-		
-		_rows=cRow;
-		_cols=cColumn;
-		for (int i = 0; i < cRow*cColumn; i++) _M.push_back(0);
-	}
+}
+
+void
+matrixD::resize(int cRow, int cColumn)
+{
+	_D.resize(cRow, cColumn);
 }
 bool
 matrixD::print()
 {
 //    cout << "Printing matrix " << _rows << " x " << _cols << endl;
-	for (int i = 0; i < _rows; i++)
+	for (int i = 0; i < _D.rows(); i++)
 	{
         cout << i;
-		for (int j = 0; j < _cols; j++)
-            cout << "\t" << _M[j+_cols*i];
+		for (int j = 0; j < _D.cols(); j++)
+            cout << "\t" << _D(i, j);
 			cout << endl;
 	}
 	return true;
@@ -76,111 +74,42 @@ matrixD::~matrixD(void)
 void
 matrixD::put(int row, int column, double value)
 {
-	if (row<=_rows && row>=0 && column<=_cols && column>=0 && _rows>0 && _cols>0)
-		_M[row*_cols+column] = value;
+	if (row<_D.rows() && row>=0 && column<_D.cols() && column>=0)
+		_D(row, column) = value;
 }
 
 double 
 matrixD::get(int row, int column)
 {
-	if (row<=_rows && row>=0 && column<=_cols && column>=0 && _rows>0 && _cols>0)
-		return _M[row*_cols+column];
+	if (row<_D.rows() && row>=0 && column<_D.cols() && column>=0)
+		return _D(row, column);
 	else 
 		return 0;
 }
 
 
-//Method for inverting symmetric matrix (www.codeproject.com/KB/recipes/LinReg.aspx) by Walt Fair, Jr.
-
 bool 
 matrixD::InvertS()
 {
-	if (_rows < 1 || _cols < 1 || _rows != _cols) return false;
-	int n = _rows;
-	double * t = new double [n];
-	double * Q = new double [n];
-	double * R = new double [n];
-	double ab;
-	int k, l, m;
-
-	for (m = 0; m < n; m++) 
-		R[m]=1;
-	k = 0;
-	for (m = 0; m < n; m++)
-	{
-		double big = 0;
-		for (l=0; l < n; l++)
-		{
-			ab = myabs(_M[l*_rows+l]);
-			if (ab > big && R[l] !=0)
-			{
-				big = ab;
-				k = l;
-			}
-		}
-		if (big == 0)
-        {
-            delete [] t;
-            delete [] Q;
-            delete [] R;
-            return false;
-        }
-		R[k] = 0;
-		Q[k] = 1 / _M[k*_rows+k];
-		t[k] = 1;
-		_M[k*_rows+k] = 0;
-		if (k !=0)
-		{
-			for (l = 0; l < k; l++)
-			{
-				t[l] = _M[l*_rows+k];
-				if (R[l] == 0)
-					Q[l] = _M[l*_rows+k] * Q[k];
-				else
-					Q[l] = -_M[l*_rows+k] * Q[k];
-				_M[l*_rows+k]=0;
-			}
-		}
-		if ((k + 1) < n)
-		{
-			for (l = k + 1; l < n; l++)
-			{
-				if (R[l] !=0)
-					t[l] = _M[k*_rows+l];
-				else
-					t[l] = -_M[k*_rows+l];
-				Q[l] = -_M[k*_rows+l] * Q[k];
-				_M[k*_rows+l]=0;
-			}
-		}
-		for (l = 0; l < n; l++)
-			for (k = l; k < n ; k++)
-				_M[l*_rows+k] = _M[l*_rows+k] + t[l] * Q[k];
-	}
-	m = n;
-	l = n - 1;
-	for (k = 1; k < n; k++) 
-	{
-		m = m - 1;
-		l = l - 1;
-		for (int j = 0; j <= l; j++)
-			_M[m*_rows+j] = _M[j*_rows+m];
-	}
-    delete [] t;
-    delete [] Q;
-    delete [] R;
+	if (_D.rows() < 1 || _D.rows() != _D.cols()) return false;
+	if (!_solver.factorise(_D.data(), _D.rows())) return false;
+	_solver.inverse(_D.data());
 	return true;
 }
 
 
 
-arrayD::arrayD(int cRow)
+arrayD::arrayD(int cRow):
+	_rows(0)
 {
-	if (cRow>0)
-	{
-		_rows=cRow;
-		for (int i = 0; i < cRow; i++) _M.push_back(0);
-	}
+	resize(cRow);
+}
+
+void
+arrayD::resize(int cRow)
+{
+	_rows = cRow>0 ? cRow : 0;
+	_M.assign(_rows, 0);
 }
 arrayD::~arrayD(void)
 {
@@ -193,14 +122,14 @@ arrayD::~arrayD(void)
 void
 arrayD::put(int row, double value)
 {
-	if (row<=_rows && row>=0 && _rows>0)
+	if (row<_rows && row>=0)
 		_M[row] = value;
 }
 
 double 
 arrayD::get(int row)
 {
-	if (row<=_rows && row>=0 && _rows>0)
+	if (row<_rows && row>=0)
 		return _M[row];
 	else 
 		return 0;
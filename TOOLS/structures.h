@@ -21,39 +21,48 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
 #include <vector>
+#include "dense.h"
+#include "solver.h"
 using namespace std;
 
+// Matrices and arrays keep their memory when resized, so that a regression
+// object can reuse them for every fit. get and put are bounds checked; hot
+// loops work on dense() / data() with the kernels of dense.h instead.
 class matrixD
 {
 private:
-	vector <double> _M;
-	int _rows;
-	int _cols;
+	denseMatrix _D;
+	ldltSolver <0> _solver;	// of InvertS
 
 public:
-	matrixD(int cRow, int cColumn);
+	matrixD(int cRow = 0, int cColumn = 0);
 	~matrixD(void);
+	void resize(int cRow, int cColumn);	// all elements 0
 	void put(int row, int column, double value);
 	double get(int row, int column);
-	int size(){return _rows*_cols;}
-	int getRows(){return _rows;}
-	int getCols(){return _cols;}
-	bool InvertS(); //invert symmetric matrix
+	int size(){return _D.size();}
+	int getRows(){return _D.rows();}
+	int getCols(){return _D.cols();}
+	denseMatrix & dense(){return _D;}
+	bool InvertS(); //invert symmetric matrix, false if not of full rank (see solver.h)
+	const ldltSolver <0> & solver(){return _solver;}	// rank and condition of the last InvertS
 	bool print();
 };
 
 class arrayD
 {
 private:
-	vector <double> _M;
+	alignedDoubles _M;
 	int _rows;
 
 public:
-	arrayD(int cRow);
+	arrayD(int cRow = 0);
 	~arrayD(void);
+	void resize(int cRow);	// all elements 0
 	void put(int row,  double value);
 	double get(int row);
 	int size(){return _rows;}
+	double * data(){return _M.data();}
     bool print();
 };
 
@@ -0,0 +1,70 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include <charconv>
+#include "textrow.h"
+
+using namespace std;
+
+template <class T>
+static inline void
+appendNumber(string & text, T x)
+{
+    char buffer[24];
+    text.append(buffer, to_chars(buffer, buffer + sizeof(buffer), x).ptr);
+}
+
+textRow &
+textRow::operator<<(int x)
+{
+    appendNumber(_text, x);
+    return *this;
+}
+
+textRow &
+textRow::operator<<(long x)
+{
+    appendNumber(_text, x);
+    return *this;
+}
+
+textRow &
+textRow::operator<<(unsigned long x)
+{
+    appendNumber(_text, x);
+    return *this;
+}
+
+// Same text as printf("%.6g"), which is what ostream writes for a double
+textRow &
+textRow::operator<<(double x)
+{
+    char buffer[32];
+    _text.append(buffer, to_chars(buffer, buffer + sizeof(buffer), x, chars_format::general, 6).ptr);
+    return *this;
+}
+
+string
+textRow::format(double x)
+{
+    string text;
+    textRow(text) << x;
+    return text;
+}
@@ -0,0 +1,50 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Builds rows of the output files in a reused string. Fields are appended with
+// << as with an ostream, and numbers come out exactly as an ostream with
+// default flags writes them (doubles as %g with 6 significant digits), but
+// are formatted with to_chars, without locale or stream state. A finished row
+// is written to its stream in one piece, without flushing.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+class textRow
+{
+public:
+    explicit textRow(std::string & text): _text(text) {}
+
+    textRow & operator<<(std::string_view s) {_text.append(s.data(), s.size()); return *this;}
+    textRow & operator<<(const std::string & s) {_text.append(s); return *this;}
+    textRow & operator<<(const char * s) {_text.append(s); return *this;}
+    textRow & operator<<(char c) {_text.push_back(c); return *this;}
+    textRow & operator<<(int x);
+    textRow & operator<<(long x);
+    textRow & operator<<(unsigned long x);
+    textRow & operator<<(double x);
+
+    static std::string format(double x);
+
+private:
+    std::string & _text;
+};
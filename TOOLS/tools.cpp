@@ -30,6 +30,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 #include <algorithm>
 #include "tools.h"
+#include "textrow.h"
 #include "../ALGLIB/studenttdistr.h"
 #include "../ALGLIB/chisquaredistr.h"
 using namespace std;
@@ -130,20 +131,25 @@ vector <bool> phenoMasker(int variant, int size)
     return X;
 }
 
-string
-HWE(double aa, double aA, double AA)
+bool
+HWEtest(double aa, double aA, double AA, double & p)
 {
-    if (aa+aA+AA<=0 || aa<0 || aA<0 || AA<0){return "NA";}
+    if (aa+aA+AA<=0 || aa<0 || aA<0 || AA<0){return false;}
     double sum = aa+aA+AA;
     double a = (2*aa + aA)/(2*sum);
     double eaa = a * a * sum;
     double eaA = 2 * a * (1-a) * sum;
     double eAA = (1-a) * (1-a) * sum;
     double chi = (((aa-eaa)*(aa-eaa))/(eaa))+(((aA-eaA)*(aA-eaA))/(eaA))+(((AA-eAA)*(AA-eAA))/(eAA));
-    double p = 1-chisquaredistribution(1,chi);
-    std::stringstream strs;
-    strs << p;
+    p = 1-chisquaredistribution(1,chi);
+    return true;
+}
+
+string
+HWE(double aa, double aA, double AA)
+{
+    double p;
     //if (p>0 & p<=1)
-    return strs.str();
+    if (HWEtest(aa, aA, AA, p)) return textRow::format(p);
     return "NA";
  }
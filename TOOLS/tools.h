@@ -43,6 +43,7 @@ string flip(string s);	//flip the alleles if
 vector <bool> phenoMasker(int, int);
 
 string  HWE(double aa, double aA, double AA);
+bool HWEtest(double aa, double aA, double AA, double & p);   //false if HWE is NA
 
 
 #endif
@@ -0,0 +1,275 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include <chrono>
+#include <iostream>
+#include <streambuf>
+#include "variantpool.h"
+
+using namespace std;
+
+#define TASKS_PER_THREAD 2          // tasks read ahead of the output per worker
+
+// Stream buffer appending to a string, so that output buffers keep their memory when reused
+class stringSink : public streambuf
+{
+public:
+    stringSink(string & s): _s(s) {}
+
+protected:
+    int_type overflow(int_type c)
+    {
+        if (c != traits_type::eof()) _s.push_back((char) c);
+        return traits_type::not_eof(c);
+    }
+    streamsize xsputn(const char * p, streamsize n)
+    {
+        _s.append(p, n);
+        return n;
+    }
+
+private:
+    string & _s;
+};
+
+// Waits on C until ready() holds and adds the time spent waiting to seconds
+template <class predicate>
+static void
+timedWait(condition_variable & C, unique_lock <mutex> & L, predicate ready, double & seconds)
+{
+    if (ready()) return;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    C.wait(L, ready);
+    seconds += chrono::duration <double> (chrono::steady_clock::now() - start).count();
+}
+
+variantPool::variantPool(int threads, int depth, analysis work, ostream & OUT, ostream & BETAS, ostream & LOG):
+    _threads(threads), _depth(depth), _work(work), _OUT(OUT), _BETAS(BETAS), _LOG(LOG),
+    _submitted(0), _written(0), _stop(false), _running(0), _failed(false),
+    _inputStats(), _outputStats()
+{
+    if (_threads > 1)
+    {
+        _running = _threads;
+        for (int i = 0; i < _threads; i++) _workers.push_back(thread(&variantPool::worker, this));
+        _writer = thread(&variantPool::writer, this);
+    }
+}
+
+variantPool::~variantPool()
+{
+    finish();
+}
+
+void
+variantPool::wait(unique_lock <mutex> & L, long pending)
+{
+    timedWait(_hasRoom, L, [this, pending]{return _failed || _submitted - _written < pending;}, _inputStats.producerWait);
+}
+
+void
+variantPool::push(job & J)
+{
+    J.id = _submitted++;
+    _inputStats.filled += _input.size();
+    _inputStats.pushes++;
+    _input.push_back(move(J));
+    _hasWork.notify_one();
+}
+
+void
+variantPool::submit(variant & V)
+{
+    if (_threads <= 1)
+    {
+        _work(V, _OUT, _BETAS, _LOG);
+        return;
+    }
+    unique_lock <mutex> L(_lock);
+    wait(L, (long) _threads * _depth);
+    if (_failed) return;
+    job J;
+    swap(J.V, V);
+    if (!_spareVariants.empty())
+    {
+        swap(V, _spareVariants.back());
+        _spareVariants.pop_back();
+    }
+    push(J);
+}
+
+void
+variantPool::submit(task T, shared_ptr <void> buffer)
+{
+    if (_failed) return;
+    if (_threads <= 1)
+    {
+        if (!T(_OUT, _BETAS, _LOG, cout)) _failed = true;
+        if (buffer) _spareBuffers.push_back(move(buffer));
+        return;
+    }
+    unique_lock <mutex> L(_lock);
+    wait(L, (long) _threads * TASKS_PER_THREAD);
+    if (_failed) return;
+    job J;
+    J.T = T;
+    J.buffer = move(buffer);
+    push(J);
+}
+
+shared_ptr <void>
+variantPool::spareBuffer()
+{
+    unique_lock <mutex> L(_lock, defer_lock);
+    if (_threads > 1) L.lock();
+    shared_ptr <void> buffer;
+    if (!_spareBuffers.empty())
+    {
+        buffer = move(_spareBuffers.back());
+        _spareBuffers.pop_back();
+    }
+    return buffer;
+}
+
+bool
+variantPool::finish()
+{
+    if (_workers.empty()) return !_failed;
+    {
+        unique_lock <mutex> L(_lock);
+        _stop = true;
+    }
+    _hasWork.notify_all();
+    for (int i = 0; i < _workers.size(); i++) _workers[i].join();
+    _workers.clear();
+    _writer.join();
+    return !_failed;
+}
+
+void
+variantPool::worker()
+{
+    while (true)
+    {
+        job J;
+        result R;
+        {
+            unique_lock <mutex> L(_lock);
+            timedWait(_hasWork, L, [this]{return _stop || !_input.empty();}, _inputStats.consumerWait);
+            if (_input.empty())
+            {
+                if (--_running == 0) _hasResult.notify_all();
+                return;
+            }
+            J = move(_input.front());
+            _input.pop_front();
+            if (!_spareResults.empty())
+            {
+                R = move(_spareResults.back());
+                _spareResults.pop_back();
+            }
+        }
+
+        R.id = J.id;
+        R.ok = true;
+        {
+            stringSink outSink(R.out), betasSink(R.betas), logSink(R.log), screenSink(R.screen);
+            ostream out(&outSink), betas(&betasSink), log(&logSink), screen(&screenSink);
+            if (_failed) R.ok = false;
+            else if (J.T) R.ok = J.T(out, betas, log, screen);
+            else _work(J.V, out, betas, log);
+        }
+
+        unique_lock <mutex> L(_lock);
+        if (!J.T) _spareVariants.push_back(move(J.V));
+        else if (J.buffer) _spareBuffers.push_back(move(J.buffer));
+        _outputStats.filled += _output.size();
+        _outputStats.pushes++;
+        _output.push_back(move(R));
+        _hasResult.notify_one();
+    }
+}
+
+void
+variantPool::writer()
+{
+    map <long, result> pending;     // finished out of order, waiting for their turn
+    deque <result> finished;
+    vector <result> written;
+    long next = 0;
+    while (true)
+    {
+        {
+            unique_lock <mutex> L(_lock);
+            for (int i = 0; i < written.size(); i++) _spareResults.push_back(move(written[i]));
+            written.clear();
+            _written = next;
+            _hasRoom.notify_all();
+            timedWait(_hasResult, L, [this]{return !_output.empty() || _running == 0;}, _outputStats.consumerWait);
+            if (_output.empty()) return;
+            finished.swap(_output);
+        }
+
+        // Write every finished job that is next in file order, nothing after a failed task
+        for (int i = 0; i < finished.size(); i++)
+        {
+            long id = finished[i].id;
+            pending[id] = move(finished[i]);
+        }
+        finished.clear();
+        map <long, result>::iterator it;
+        while ((it = pending.find(next)) != pending.end())
+        {
+            result & R = it->second;
+            if (!_failed)
+            {
+                write(R);
+                if (!R.ok) _failed = true;
+            }
+            R.out.clear();
+            R.betas.clear();
+            R.log.clear();
+            R.screen.clear();
+            written.push_back(move(R));
+            pending.erase(it);
+            next++;
+        }
+    }
+}
+
+void
+variantPool::write(result & R)
+{
+    _OUT << R.out;
+    _BETAS << R.betas;
+    _LOG << R.log;
+    cout << R.screen;
+}
+
+void
+variantPool::report(ostream & LOG) const
+{
+    if (_threads <= 1) return;
+    LOG << "Read stage: " << (_inputStats.pushes ? _inputStats.filled / _inputStats.pushes : 0)
+        << " jobs queued for analysis on average, waited " << _inputStats.producerWait << " s for the analysis" << endl;
+    LOG << "Analysis stage: " << _threads << " workers waited " << _inputStats.consumerWait << " s in total for input" << endl;
+    LOG << "Write stage: " << (_outputStats.pushes ? _outputStats.filled / _outputStats.pushes : 0)
+        << " results queued for writing on average, waited " << _outputStats.consumerWait << " s for results" << endl;
+}
@@ -0,0 +1,126 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// Runs the analysis of variants as a pipeline of three stages:
+//
+//   read (calling thread) -> input queue -> analyse (workers) -> output queue -> write (writer thread)
+//
+// The genotype file reader submits variants in file order; every worker
+// formats its results into private buffers and the writer thread writes the
+// buffers to the output streams strictly in submission order, so the output
+// is the same as with a single thread. With one thread variants are analysed
+// and written directly on the calling thread.
+//
+// A reader can also submit tasks, each reading and analysing a whole range
+// of the input on a worker. Tasks are ordered with the variants and also
+// get a buffer for screen output; a task returning false stops the pool.
+// A task may come with a buffer holding its input: once the task has run,
+// the worker hands the buffer back under the pool lock, and the reader gets
+// it with spareBuffer() to fill for another task.
+//
+// Both queues are bounded: the reader may be at most `depth` variants per
+// worker (or two tasks per worker) ahead of the writer. Variants and output
+// buffers are handed back to the reader and the workers for reuse. The time
+// every stage spent waiting on its neighbours is reported by report().
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../variant.h"
+
+class variantPool
+{
+public:
+    typedef std::function <void (variant &, std::ostream &, std::ostream &, std::ostream &)> analysis;
+    typedef std::function <bool (std::ostream &, std::ostream &, std::ostream &, std::ostream &)> task;
+
+    variantPool(int threads, int depth, analysis work, std::ostream & OUT, std::ostream & BETAS, std::ostream & LOG);
+    ~variantPool();
+    void submit(variant & V);       // takes over contents of V, V gets a used variant back for reuse
+    void submit(task T, std::shared_ptr <void> buffer = std::shared_ptr <void> ());  // T(OUT, BETAS, LOG, screen), buffer is reused after T
+    std::shared_ptr <void> spareBuffer();   // buffer of a task that has run, empty if none
+    bool finish();                  // wait until all submitted work is written; false if a task failed
+    bool failed() const {return _failed;}
+    void report(std::ostream & LOG) const;  // occupancy of the queues and waiting time of the stages
+
+private:
+    struct job
+    {
+        long id;
+        variant V;
+        task T;                     // empty for a variant
+        std::shared_ptr <void> buffer;  // input of T
+    };
+    struct result
+    {
+        long id;
+        std::string out, betas, log, screen;
+        bool ok;
+    };
+    struct queueStats
+    {
+        double filled;              // sum of queue lengths seen by the producer
+        long pushes;
+        double producerWait;        // seconds the producer waited for room
+        double consumerWait;        // seconds the consumers waited for data
+    };
+
+    int _threads;
+    long _depth;
+    analysis _work;
+    std::ostream & _OUT;
+    std::ostream & _BETAS;
+    std::ostream & _LOG;
+
+    std::vector <std::thread> _workers;
+    std::thread _writer;
+    std::mutex _lock;
+    std::condition_variable _hasWork;       // input queue not empty
+    std::condition_variable _hasResult;     // output queue not empty
+    std::condition_variable _hasRoom;       // reader may submit
+    std::deque <job> _input;
+    std::deque <result> _output;
+    std::vector <variant> _spareVariants;   // analysed variants, for the reader to reuse
+    std::vector <std::shared_ptr <void> > _spareBuffers;    // buffers of tasks that have run, for the reader to reuse
+    std::vector <result> _spareResults;     // written buffers, for the workers to reuse
+    long _submitted;
+    long _written;
+    bool _stop;                     // no more input
+    int _running;                   // workers not yet finished
+    std::atomic <bool> _failed;     // a task returned false, nothing after it is written
+    queueStats _inputStats;
+    queueStats _outputStats;
+
+    void wait(std::unique_lock <std::mutex> & L, long pending);
+    void push(job & J);
+    void worker();
+    void writer();
+    void write(result & R);
+};
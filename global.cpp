@@ -30,8 +30,12 @@ global::global(void)
     printComplex = false;
     printBetas = false;
     printCovariance = false;
+    binaryOutput = false;
+    compression = outputFile::PLAIN;
         threshold=0.95;
     chr=0;
+    threads=1;
+    queueDepth=64;
 }
 
 global::~global(void)
@@ -41,9 +45,10 @@ global::~global(void)
 void
 global::createOutput()
 {
-	outputResult = outputRoot + ".result";
-	outputLog = outputRoot + ".log";
-    outputBetas = outputRoot + ".betas";
+	std::string extension = outputFile::extension(compression);
+	outputResult = outputRoot + (binaryOutput ? ".rbin" : ".result") + extension;
+	outputLog = outputRoot + ".log" + extension;
+    outputBetas = outputRoot + ".betas" + extension;
 	outputError = outputRoot + ".err";
 }
 
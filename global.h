@@ -27,6 +27,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 
 #include "sample.h"
+#include "TOOLS/idset.h"
+#include "TOOLS/genomicrange.h"
+#include "TOOLS/outputfile.h"
 
 class global
 {
@@ -44,21 +47,29 @@ public:
 	std::string inputGenFile;
 	std::string inputSampleFile;
     std::string inputExclFile;
+    std::string inputInclFile;
 	std::string outputRoot;
 	std::string outputResult;
 	std::string outputLog;
 	std::string outputBetas;
 	std::string outputError;
 	std::string missingCode;
-    std::map <std::string, int> exclusionList;
+    idSet exclusionList;                                 //markers (rsid, SNPID or chr:pos) to skip
+    idSet inclusionList;                                 //if not empty, only these markers are analysed
+    std::string inputSnpListFile;
+    std::vector <genomicRange> ranges;                   //markers in these regions are analysed with the inclusion list
     bool removeMissing;
     bool printAll;
     bool printComplex;
     bool printBetas;
     bool printCovariance;
+    bool binaryOutput;                                   //results to .rbin instead of .result
+    outputFile::compression compression;                 //of the .result, .betas and .log files
     
     int chr;
-    std::vector <sample> samples;
+    int threads;
+    int queueDepth;                                      //variants read ahead of the output per thread
+    phenotypeTable phenotypes;                           //of all samples in the sample file
     
 };
 #endif
@@ -25,13 +25,26 @@
 #include <fstream>
 #include <cctype> // std::toupper
 #include <map>
+#include <charconv>
+#include <cstring>
 
 #include <zlib.h>
 #include "global.h"
+#include "variant.h"
 #include "TCLAP/CmdLine.h"
 #include "TOOLS/tools.h"
 #include "TOOLS/structures.h"
 #include "TOOLS/regression.h"
+#include "TOOLS/maskmodels.h"
+#include "TOOLS/variantpool.h"
+#include "TOOLS/mappedfile.h"
+#include "TOOLS/genline.h"
+#include "TOOLS/gzlinereader.h"
+#include "TOOLS/textrow.h"
+#include "TOOLS/resultfile.h"
+#include "TOOLS/outputfile.h"
+#include "TOOLS/bgenindex.h"
+#include "TOOLS/simd.h"
 #include "ALGLIB/studenttdistr.h"
 #include "ALGLIB/chisquaredistr.h"
 
@@ -43,9 +56,14 @@
 // SOURCE: BGEN Library API (https://enkre.net/cgi-bin/code/bgen/)
 #include "BGEN/MissingValue.cpp"
 #include "BGEN/zlib.cpp"
+#include "BGEN/zstd.cpp"
 #include "BGEN/bgen.cpp"
+#include "BGEN/unpack.cpp"
 
-#define LENS 1000000
+#define BGEN_READAHEAD (32 << 20)   // bytes of mapped BGEN file requested ahead of the parser
+#define BGEN_SEEK_READAHEAD (1 << 20)   // read-ahead after a seek, doubled while reading on
+#define GEN_CHUNK (8 << 20)         // bytes of a GEN file read and analysed by one task
+#define BGEN_BATCH 64               // BGEN variants uncompressed and analysed by one task
 using namespace TCLAP;
 using namespace std;
 
@@ -113,6 +131,200 @@ private:
 	std::size_t m_entry_i ;
 } ;
 
+// Dosages of one variant in flat arrays owned by the caller and reused between variants,
+// together with the genotype sums needed for QC.
+struct DosageData {
+	std::vector< double > dose ;		// 2*P(BB)+P(AB) per sample: dosage of the second allele
+	std::vector< double > firstDose ;	// 2*P(AA)+P(AB) per sample: dosage of the first allele
+	std::vector< char > missing ;		// no genotype data for sample (both dosages are left at zero)
+	double aa, aA, AA ;				// expected genotype counts of samples with valid probabilities
+	double fijeij ;					// sum of fij-eij^2 of samples with valid probabilities (info score)
+	std::size_t valid, invalid ;		// samples with probabilities summing to one / other samples
+} ;
+
+// Setter for genfile::bgen::parse_probability_data writing straight into DosageData.
+// Only diploid biallelic genotypes (three probabilities) are used, other samples count as invalid.
+struct DosageSetter {
+	DosageSetter( DosageData* result ):
+		m_result( result ),
+		m_sample_i(0),
+		m_entries(0),
+		m_entry_i(0),
+		m_missing( false )
+	{}
+
+	void initialise( std::size_t number_of_samples, std::size_t number_of_alleles ) {
+		m_result->dose.assign( number_of_samples, 0 ) ;
+		m_result->firstDose.assign( number_of_samples, 0 ) ;
+		m_result->missing.assign( number_of_samples, 1 ) ;
+		m_result->aa = m_result->aA = m_result->AA = 0 ;
+		m_result->fijeij = 0 ;
+		m_result->valid = 0 ;
+		m_result->invalid = number_of_samples ;
+	}
+
+	bool set_sample( std::size_t i ) {
+		m_sample_i = i ;
+		return true ;
+	}
+
+	void set_number_of_entries(
+		std::size_t ploidy,
+		std::size_t number_of_entries,
+		genfile::OrderType order_type,
+		genfile::ValueType value_type
+	) {
+		assert( value_type == genfile::eProbability ) ;
+		m_entries = number_of_entries ;
+		m_entry_i = 0 ;
+		m_missing = false ;
+	}
+
+	void set_value( uint32_t, double value ) {
+		if( m_entry_i < 3 ) m_p[ m_entry_i ] = value ;
+		if( ++m_entry_i == m_entries ) set_sample_values() ;
+	}
+
+	void set_value( uint32_t, genfile::MissingValue value ) {
+		m_missing = true ;
+		if( ++m_entry_i == m_entries ) set_sample_values() ;
+	}
+
+	void finalise() {}
+
+private:
+	DosageData* m_result ;
+	std::size_t m_sample_i ;
+	std::size_t m_entries ;
+	std::size_t m_entry_i ;
+	bool m_missing ;
+	double m_p[3] ;
+
+	void set_sample_values() {
+		if( m_missing || m_entries != 3 ) return ;
+		DosageData& r = *m_result ;
+		double const* p = m_p ;
+		r.missing[ m_sample_i ] = 0 ;
+		r.dose[ m_sample_i ] = 2*p[2]+p[1] ;
+		r.firstDose[ m_sample_i ] = 2*p[0]+p[1] ;
+		if( p[0]+p[1]+p[2] == 1 ) {
+			r.aa += p[0] ;
+			r.aA += p[1] ;
+			r.AA += p[2] ;
+			double eij = (2*p[2]) + p[1] ;
+			double fij = (4*p[2]) + p[1] ;
+			r.fijeij += fij - (eij*eij) ;
+			r.valid++ ;
+			r.invalid-- ;
+		}
+	}
+} ;
+
+// With 8 bits per probability the two stored values of a diploid biallelic sample form a
+// 16-bit index.  Each table entry holds everything DosageSetter derives from the sample's
+// probabilities, computed the same way, so no per-sample arithmetic is left.
+struct Dosage8BitTable {
+	struct alignas(64) Entry {		// one cache line
+		double p[3] ;
+		double dose ;
+		double firstDose ;
+		double fijeij ;
+		double valid ;
+	} ;
+
+	Dosage8BitTable(): m_entries( 65536 ) {
+		for( int a = 0; a < 256; ++a ) {
+			for( int b = 0; b < 256; ++b ) {
+				Entry& e = m_entries[ a | ( b << 8 ) ] ;
+				double const p0 = a / 255.0 ;
+				double const p1 = b / 255.0 ;
+				double sum = 0.0 ;
+				sum += p0 ;
+				sum += p1 ;
+				e.p[0] = p0 ;
+				e.p[1] = p1 ;
+				e.p[2] = 1.0 - sum ;
+				e.dose = 2*e.p[2]+e.p[1] ;
+				e.firstDose = 2*e.p[0]+e.p[1] ;
+				double eij = (2*e.p[2]) + e.p[1] ;
+				double fij = (4*e.p[2]) + e.p[1] ;
+				e.fijeij = fij - (eij*eij) ;
+				e.valid = ( e.p[0]+e.p[1]+e.p[2] == 1 ) ;
+			}
+		}
+	}
+
+	static Dosage8BitTable const& get() {
+		static Dosage8BitTable const table ;
+		return table ;
+	}
+
+	std::vector< Entry > m_entries ;
+} ;
+
+// Decode a v1.2 probability block into data if it holds unphased diploid biallelic data stored
+// with 8 bits; returns false, leaving data untouched, for any other block.
+bool read_8bit_dosages(
+	genfile::byte_t const* buffer,
+	genfile::byte_t const* const end,
+	genfile::bgen::Context const& context,
+	DosageData* data
+) {
+	uint32_t numberOfSamples ;
+	uint16_t numberOfAlleles ;
+	genfile::byte_t ploidyExtent[2] ;
+
+	if( end < buffer + 8 ) {
+		throw genfile::bgen::BGenError() ;
+	}
+	buffer = genfile::bgen::read_little_endian_integer( buffer, end, &numberOfSamples ) ;
+	buffer = genfile::bgen::read_little_endian_integer( buffer, end, &numberOfAlleles ) ;
+	ploidyExtent[0] = *buffer++ ;
+	ploidyExtent[1] = *buffer++ ;
+	if( numberOfSamples != context.number_of_samples ) {
+		throw genfile::bgen::BGenError() ;
+	}
+	if( std::size_t( end - buffer ) < std::size_t( numberOfSamples ) + 2 ) {
+		throw genfile::bgen::BGenError() ;
+	}
+	genfile::byte_t const* ploidy = buffer ;
+	buffer += numberOfSamples ;
+	bool const phased = ( *buffer++ ) & 0x1 ;
+	int const bits = *buffer++ ;
+	if( phased || numberOfAlleles != 2 || ploidyExtent[0] != 2 || ploidyExtent[1] != 2 || bits != 8 ) {
+		return false ;
+	}
+	if( std::size_t( end - buffer ) < 2 * std::size_t( numberOfSamples ) ) {
+		throw genfile::bgen::BGenError() ;
+	}
+
+	DosageData& r = *data ;
+	r.dose.assign( numberOfSamples, 0 ) ;
+	r.firstDose.assign( numberOfSamples, 0 ) ;
+	r.missing.assign( numberOfSamples, 1 ) ;
+	r.aa = r.aA = r.AA = 0 ;
+	r.fijeij = 0 ;
+	r.valid = 0 ;
+
+	Dosage8BitTable::Entry const* table = &Dosage8BitTable::get().m_entries[0] ;
+	for( uint32_t i = 0; i < numberOfSamples; ++i, buffer += 2 ) {
+		if( ploidy[i] & 0x80 ) continue ;
+		Dosage8BitTable::Entry const& e = table[ buffer[0] | ( buffer[1] << 8 ) ] ;
+		r.missing[i] = 0 ;
+		r.dose[i] = e.dose ;
+		r.firstDose[i] = e.firstDose ;
+		if( e.valid != 0 ) {
+			r.aa += e.p[0] ;
+			r.aA += e.p[1] ;
+			r.AA += e.p[2] ;
+			r.fijeij += e.fijeij ;
+			r.valid++ ;
+		}
+	}
+	r.invalid = numberOfSamples - r.valid ;
+	return true ;
+}
+
 // SOURCE: BGEN Library API (https://enkre.net/cgi-bin/code/bgen/)
 // BgenParser is a thin wrapper around the core functions in bgen.hpp.
 // This class tracks file state and handles passing the right callbacks.
@@ -121,7 +333,11 @@ struct BgenParser {
 	BgenParser( std::string const& filename ):
 		m_filename( filename ),
 		m_state( e_NotOpen ),
-		m_have_sample_ids( false )
+		m_have_sample_ids( false ),
+		m_pos( 0 ),
+		m_end( 0 ),
+		m_advised( 0 ),
+		m_window( BGEN_READAHEAD )
 	{
 		// Open the stream
 		m_stream.reset(
@@ -143,9 +359,31 @@ struct BgenParser {
 			m_have_sample_ids = true ;
 		}
 
+		if( ( m_context.flags & genfile::bgen::e_CompressedSNPBlocks ) == genfile::bgen::e_ZstdCompression && !HAVE_ZSTD ) {
+			std::cerr << "BGEN file " << filename << " is zstd compressed, but SCOPA was built without zstd support (make ZSTD=1).\n" ;
+			throw genfile::bgen::BGenError() ;
+		}
+
 		// Jump to the first variant data block.
 		m_stream->seekg( m_offset + 4 ) ;
 
+		// Variants of v1.1 and v1.2 files are parsed in place from a memory mapping where possible,
+		// the stream is used otherwise.
+		uint32_t const layout = m_context.flags & genfile::bgen::e_Layout ;
+		if(
+			( layout == genfile::bgen::e_v11Layout || layout == genfile::bgen::e_v12Layout )
+			&& m_map.open( filename ) && m_map.size() >= std::size_t( m_offset ) + 4
+		) {
+			genfile::byte_t const* data = reinterpret_cast< genfile::byte_t const* >( m_map.data() ) ;
+			m_pos = data + m_offset + 4 ;
+			m_end = data + m_map.size() ;
+			m_advised = m_offset + 4 ;
+			m_map.sequential() ;
+			m_stream.reset() ;
+		} else {
+			m_map.close() ;
+		}
+
 		// We keep track of state (though it's not really needed for this implementation.)
 		m_state = e_ReadyForVariant ;
 	}
@@ -154,7 +392,9 @@ struct BgenParser {
 		o << "BgenParser: bgen file ("
 			<< ( m_context.flags & genfile::bgen::e_Layout ? "v1.2 layout" : "v1.1 layout" )
 			<< ", "
-			<< ( m_context.flags & genfile::bgen::e_CompressedSNPBlocks ? "compressed" : "uncompressed" ) << ")"
+			<< ( m_context.flags & genfile::bgen::e_CompressedSNPBlocks
+				? ( ( m_context.flags & genfile::bgen::e_CompressedSNPBlocks ) == genfile::bgen::e_ZstdCompression ? "zstd compressed" : "zlib compressed" )
+				: "uncompressed" ) << ")"
 			<< " with "
 			<< m_context.number_of_samples << " " << ( m_have_sample_ids ? "named" : "anonymous" ) << " samples and "
 			<< m_context.number_of_variants << " variants.\n" ;
@@ -181,47 +421,124 @@ struct BgenParser {
 	}
 
 	// Attempt to read identifying information about a variant from the bgen file, returning
-	// it in the given fields.
+	// it in the given fields.  The fields are views that remain valid until the next call.
 	// If this method returns true, data was successfully read, and it should be safe to call read_probs()
 	// or ignore_probs().
 	// If this method returns false, data was not successfully read indicating the end of the file.
 	bool read_variant(
-		std::string* chromosome,
+		std::string_view* chromosome,
 		uint32_t* position,
-		std::string* rsid,
-		std::vector< std::string >* alleles
+		std::string_view* rsid,
+		std::vector< std::string_view >* alleles,
+		std::string_view* SNPID
 	) {
 		assert( m_state == e_ReadyForVariant ) ;
-		std::string SNPID ; // read but ignored in this toy implementation
+		bool ok ;
 
-		if(
-			genfile::bgen::read_snp_identifying_data(
-				*m_stream, m_context,
-				&SNPID, rsid, chromosome, position,
+		if( m_map.isOpen() ) {
+			advise() ;
+			ok = genfile::bgen::read_snp_identifying_data(
+				&m_pos, m_end, m_context,
+				SNPID, rsid, chromosome, position,
 				[&alleles]( std::size_t n ) { alleles->resize( n ) ; },
-				[&alleles]( std::size_t i, std::string const& allele ) { alleles->at(i) = allele ; }
-			)
-		) {
-			m_state = e_ReadyForProbs ;
-			return true ;
+				[&alleles]( std::size_t i, std::string_view allele ) { alleles->at(i) = allele ; }
+			) ;
 		} else {
-			return false ;
+			std::vector< std::string >& a = m_alleles ;
+			ok = genfile::bgen::read_snp_identifying_data(
+				*m_stream, m_context,
+				&m_SNPID, &m_rsid, &m_chromosome, position,
+				[&a]( std::size_t n ) { a.resize( n ) ; },
+				[&a]( std::size_t i, std::string const& allele ) { a.at(i) = allele ; }
+			) ;
+			if( ok ) {
+				*chromosome = m_chromosome ;
+				*rsid = m_rsid ;
+				*SNPID = m_SNPID ;
+				alleles->assign( m_alleles.begin(), m_alleles.end() ) ;
+			}
+		}
+		if( ok ) {
+			m_state = e_ReadyForProbs ;
 		}
+		return ok ;
 	}
 
 	// Read genotype probability data for the SNP just read using read_variant()
 	// After calling this method it should be safe to call read_variant() to fetch
 	// the next variant from the file.
 	void read_probs( std::vector< std::vector< double > >* probs ) {
-		assert( m_state == e_ReadyForProbs ) ;
 		ProbSetter setter( probs ) ;
-		genfile::bgen::read_and_parse_genotype_data_block< ProbSetter >(
-			*m_stream,
-			m_context,
-			setter,
-			&m_buffer1,
-			&m_buffer2
-		) ;
+		genfile::byte_t const* begin ;
+		genfile::byte_t const* end ;
+		read_probability_data( &begin, &end ) ;
+		genfile::bgen::parse_probability_data( begin, end, m_context, setter ) ;
+	}
+
+	// As above, but set dosages and genotype sums directly into the reusable flat buffers of data.
+	void read_probs( DosageData* data ) {
+		genfile::byte_t const* begin ;
+		genfile::byte_t const* end ;
+		read_compressed_probs( &begin, &end ) ;
+		decode_probs( m_context, begin, end, &m_buffer2, data ) ;
+	}
+
+	// Locate the still compressed probability data of the SNP just read using read_variant(), so
+	// that it can be decoded elsewhere with decode_probs().  The data is valid until the next call.
+	void read_compressed_probs( genfile::byte_t const** begin, genfile::byte_t const** end ) {
+		assert( m_state == e_ReadyForProbs ) ;
+		if( m_map.isOpen() ) {
+			genfile::bgen::read_genotype_data_block( &m_pos, m_end, m_context, begin, end ) ;
+		} else {
+			genfile::bgen::read_genotype_data_block( *m_stream, m_context, &m_buffer1 ) ;
+			*begin = &m_buffer1[0] ;
+			*end = &m_buffer1[0] + m_buffer1.size() ;
+		}
+		m_state = e_ReadyForVariant ;
+	}
+
+	// Uncompress (into buffer) and decode the probability data of one variant into data.
+	// 8-bit v1.2 data is decoded through a lookup table, other data through DosageSetter.
+	static void decode_probs(
+		genfile::bgen::Context const& context,
+		genfile::byte_t const* begin,
+		genfile::byte_t const* end,
+		std::vector< genfile::byte_t >* buffer,
+		DosageData* data
+	) {
+		if( context.flags & genfile::bgen::e_CompressedSNPBlocks ) {
+			genfile::bgen::uncompress_probability_data( context, begin, end, buffer ) ;
+			begin = &(*buffer)[0] ;
+			end = &(*buffer)[0] + buffer->size() ;
+		}
+		if(
+			( context.flags & genfile::bgen::e_Layout ) != genfile::bgen::e_v12Layout
+			|| !read_8bit_dosages( begin, end, context, data )
+		) {
+			DosageSetter setter( data ) ;
+			genfile::bgen::parse_probability_data( begin, end, context, setter ) ;
+		}
+	}
+
+	genfile::bgen::Context const& context() const {
+		return m_context ;
+	}
+
+	// Continue with the variant starting at the given file offset (from a bgenIndex),
+	// read_variant() reads it next.
+	void seek( uint64_t offset ) {
+		if( m_map.isOpen() ) {
+			genfile::byte_t const* data = reinterpret_cast< genfile::byte_t const* >( m_map.data() ) ;
+			m_pos = data + std::min< uint64_t >( offset, m_map.size() ) ;
+			// Far from the pages requested so far, start reading ahead with a small window
+			if( offset > m_advised || offset + m_window < m_advised ) {
+				m_advised = offset ;
+				m_window = BGEN_SEEK_READAHEAD ;
+			}
+		} else {
+			m_stream->clear() ;
+			m_stream->seekg( offset ) ;
+		}
 		m_state = e_ReadyForVariant ;
 	}
 
@@ -229,7 +546,13 @@ struct BgenParser {
 	// After calling this method it should be safe to call read_variant()
 	// to fetch the next variant from the file.
 	void ignore_probs() {
-		genfile::bgen::ignore_genotype_data_block( *m_stream, m_context ) ;
+		if( m_map.isOpen() ) {
+			genfile::byte_t const* payload ;
+			genfile::byte_t const* payload_end ;
+			genfile::bgen::read_genotype_data_block( &m_pos, m_end, m_context, &payload, &payload_end ) ;
+		} else {
+			genfile::bgen::ignore_genotype_data_block( *m_stream, m_context ) ;
+		}
 		m_state = e_ReadyForVariant ;
 	}
 
@@ -257,12 +580,48 @@ private:
 
 	// Buffers, these are used as working space by bgen implementation.
 	std::vector< genfile::byte_t > m_buffer1, m_buffer2 ;
+
+	// Variant fields read from the stream, read_variant() returns views of these.
+	std::string m_chromosome, m_rsid, m_SNPID ;
+	std::vector< std::string > m_alleles ;
+
+	// Memory mapped file and the current read position in it.
+	mappedFile m_map ;
+	genfile::byte_t const* m_pos ;
+	genfile::byte_t const* m_end ;
+	std::size_t m_advised ;	// file offset up to which read-ahead has been requested
+	std::size_t m_window ;	// bytes requested at a time
+
+	// Locate the uncompressed probability data of the current variant.  The compressed block is
+	// read straight from the mapped pages and uncompressed data is used in place; the stream
+	// reader goes through the working buffers.
+	void read_probability_data( genfile::byte_t const** begin, genfile::byte_t const** end ) {
+		read_compressed_probs( begin, end ) ;
+		if( m_context.flags & genfile::bgen::e_CompressedSNPBlocks ) {
+			genfile::bgen::uncompress_probability_data( m_context, *begin, *end, &m_buffer2 ) ;
+			*begin = &m_buffer2[0] ;
+			*end = &m_buffer2[0] + m_buffer2.size() ;
+		}
+	}
+
+	// Keep the kernel reading ahead of the parser.
+	void advise() {
+		std::size_t const offset = m_pos - reinterpret_cast< genfile::byte_t const* >( m_map.data() ) ;
+		if( offset + m_window / 2 >= m_advised ) {
+			m_map.willNeed( m_advised, m_window ) ;
+			m_advised += m_window ;
+			if( m_window < BGEN_READAHEAD ) m_window *= 2 ;
+		}
+	}
 } ;
 
 double ddabs(double d){if(d<0)return d*-1;return d;}
-bool readSampleFile(global & G, ofstream & LOG);
-bool readGenoFile(global & G, ofstream & LOG);
-bool readExclFile(global & G, ofstream & LOG);
+bool readSampleFile(global & G, ostream & LOG);
+bool readGenoFile(global & G, ostream & LOG);
+bool readMarkerList(global & G, const string & fileName, idSet & markers, const string & listName, ostream & LOG);
+bool skipMarker(const global & G, string_view id1, string_view id2, string_view chromosome, string_view pos);
+bool variantQC(const global & G, variant & V, double fijeij);
+void analyseVariant(const global & G, const maskModels & MM, variant & V, ostream & OUT, ostream & BETAS, ostream & LOG);
 int main (int argc,  char * argv[])
 {
     global GLOBAL;
@@ -275,6 +634,10 @@ int main (int argc,  char * argv[])
         ValueArg<string> genofArg("g","gen","This specifies genotype file",true,"","string", cmd);
         ValueArg<string> outfArg("o","out","This specifies output root",true,"","string", cmd);
         ValueArg<string> exclfArg("e","exclusion","This specifies marker exclusion list",false,"","string", cmd);
+        ValueArg<string> inclfArg("i","inclusion","This specifies marker inclusion list",false,"","string", cmd);
+        ValueArg<string> snpListArg("","snp_list","This specifies a list of markers to analyse, like the inclusion list",false,"","string", cmd);
+        MultiArg<string> snpArg("","snp","Marker to analyse: rsid, SNPID or chr:position (use this command multiple times for several markers)", false, "string", cmd);
+        MultiArg<string> rangeArg("","range","Region to analyse: chr:start-end (use this command multiple times for several regions)", false, "string", cmd);
         ValueArg<string> naArg("","missing_phenotype","This specifies missing data value (default NA)",false,"","string", cmd);
         ValueArg<double> thresholdArg("", "imp_threshold", "Imputation quality threshold (default 0)", false, 0,"double" , cmd);
 
@@ -286,12 +649,19 @@ int main (int argc,  char * argv[])
         SwitchArg printComplexArg("", "print_complex","Print only the model with all phenotypes (default OFF)", cmd);
         SwitchArg printCovarianceArg("", "print_covariance","Print covariance matrix data for the model with all phenotypes (default OFF)", cmd);
         SwitchArg debugArg("", "debug","Debug mode on (default OFF)", cmd);
+        SwitchArg binaryArg("", "binary","Write results to a binary .rbin file instead of the .result file, SCOPA_CONVERT turns it into text (default OFF)", cmd);
+        ValueArg<string> compressArg("", "compress", "Compress the .result, .betas and .log files: gz (BGZF) or zstd (default none, or gz/zstd if the output root ends with .gz/.zst)", false, "", "string", cmd);
+        ValueArg<int> threadsArg("", "threads", "Number of threads for the analysis of variants (default 1)", false, 1, "int", cmd);
+        ValueArg<int> queueDepthArg("", "queue_depth", "Variants read ahead of the output per thread (default 64)", false, 64, "int", cmd);
+        ValueArg<string> simdArg("", "simd", "Vector instructions of the analysis: scalar, sse4.2, avx2 or avx512 (default auto, the best this CPU supports)", false, "auto", "string", cmd);
         cmd.parse(argc,argv);
 
         GLOBAL.inputSampleFile = samplefArg.getValue();
         GLOBAL.inputGenFile = genofArg.getValue();
         GLOBAL.phenoList = phenoNamesArg.getValue();
         GLOBAL.inputExclFile = exclfArg.getValue();
+        GLOBAL.inputInclFile = inclfArg.getValue();
+        GLOBAL.inputSnpListFile = snpListArg.getValue();
         if (naArg.getValue() != "")GLOBAL.missingCode = naArg.getValue();
         GLOBAL.removeMissing = rmmissingArg.getValue();
         GLOBAL.printAll = printallArg.getValue();
@@ -299,16 +669,44 @@ int main (int argc,  char * argv[])
         GLOBAL.printComplex = printComplexArg.getValue();
         GLOBAL.printCovariance = printCovarianceArg.getValue();
         GLOBAL.debugMode = debugArg.getValue();
+        GLOBAL.binaryOutput = binaryArg.getValue();
         GLOBAL.outputRoot = outfArg.getValue();
         GLOBAL.threshold = thresholdArg.getValue();
         GLOBAL.chr = chrArg.getValue();
+        GLOBAL.threads = threadsArg.getValue();
+        GLOBAL.queueDepth = queueDepthArg.getValue();
         if (GLOBAL.phenoList.size()<2)
         {
             cout<< "Less than 2 phenotypes selected for the analysis. Please add additional phenotypes for pleiotropy testing. Exit program!" <<endl;
             exit(1);
         }
+        string compress = compressArg.getValue();
+        if (compress == "")
+        {
+            // output root ending with .gz or .zst selects the compression
+            if (GLOBAL.outputRoot.size() > 3 && GLOBAL.outputRoot.substr(GLOBAL.outputRoot.size() - 3) == ".gz") compress = "gz";
+            else if (GLOBAL.outputRoot.size() > 4 && GLOBAL.outputRoot.substr(GLOBAL.outputRoot.size() - 4) == ".zst") compress = "zstd";
+            if (compress != "") GLOBAL.outputRoot.erase(GLOBAL.outputRoot.rfind('.'));
+        }
+        if (compress == "gz" || compress == "gzip" || compress == "bgzf") GLOBAL.compression = outputFile::GZIP;
+        else if (compress == "zstd" || compress == "zst") GLOBAL.compression = outputFile::ZSTD;
+        else if (compress != "" && compress != "none")
+        {
+            cout << "Unknown output compression " << compress << ", use gz or zstd. Exit program!" << endl;
+            exit(1);
+        }
+        if (!outputFile::available(GLOBAL.compression))
+        {
+            cout << "SCOPA was built without zstd support (make ZSTD=1), use --compress gz. Exit program!" << endl;
+            exit(1);
+        }
         GLOBAL.createOutput();
-        ofstream LOG (GLOBAL.outputLog.c_str());
+        outputFile LOG;
+        if (!LOG.open(GLOBAL.outputLog, GLOBAL.compression))
+        {
+            cout << "Cannot create log file " << GLOBAL.outputLog << ". Exit program!" << endl;
+            exit(1);
+        }
         cout << "###################\n# SCOPA v." << GLOBAL.version << "\n###################\n" << endl;
 
 
@@ -338,6 +736,28 @@ int main (int argc,  char * argv[])
         else if (GLOBAL.printComplex){LOG << "Print only the model with all phenotypes (print_complex ON)"<<endl;}
         else {LOG << "Print only best model (print_all OFF)"<<endl;}
         if (GLOBAL.debugMode) {LOG << "DEBUG MODE ON"<<endl;}
+        if (GLOBAL.threads<1)
+        {
+            cout << "Number of threads must be at least 1. Exit program.";
+            exit(1);
+        }
+        if (GLOBAL.debugMode && GLOBAL.threads>1)
+        {
+            LOG << "Debug mode is running with single thread" << endl;
+            GLOBAL.threads = 1;
+        }
+        if (GLOBAL.queueDepth<1)
+        {
+            cout << "Queue depth must be at least 1. Exit program.";
+            exit(1);
+        }
+        if (GLOBAL.threads>1) {LOG << "Threads: " << GLOBAL.threads << ", queue depth: " << GLOBAL.queueDepth << endl;}
+        if (!simdKernels::select(simdArg.getValue()))
+        {
+            cout << "Vector instructions " << simdArg.getValue() << " are unknown or not supported by this CPU (best: " << simdKernels::name(simdKernels::detect()) << "). Exit program.";
+            exit(1);
+        }
+        LOG << "Vector instructions: " << simdKernels::name(simdKernels::current()) << endl;
         if (GLOBAL.printBetas){LOG << "Creating file for saving all beta and stderr values for all phenotypes in all selected models" << endl;}
 
         if (GLOBAL.threshold<0 || GLOBAL.threshold>1)
@@ -353,7 +773,33 @@ int main (int argc,  char * argv[])
         if (GLOBAL.inputExclFile != "")
         {
             cout << "Reading exclusion list file..." << endl;
-            readExclFile(GLOBAL, LOG);
+            readMarkerList(GLOBAL, GLOBAL.inputExclFile, GLOBAL.exclusionList, "Exclusion", LOG);
+        }
+        if (GLOBAL.inputInclFile != "")
+        {
+            cout << "Reading inclusion list file..." << endl;
+            readMarkerList(GLOBAL, GLOBAL.inputInclFile, GLOBAL.inclusionList, "Inclusion", LOG);
+        }
+        if (GLOBAL.inputSnpListFile != "")
+        {
+            cout << "Reading SNP list file..." << endl;
+            readMarkerList(GLOBAL, GLOBAL.inputSnpListFile, GLOBAL.inclusionList, "SNP", LOG);
+        }
+        for (int i = 0; i < snpArg.getValue().size(); i++)
+        {
+            GLOBAL.inclusionList.insert(snpArg.getValue()[i]);
+            LOG << "Analyse marker: " << snpArg.getValue()[i] << endl;
+        }
+        for (int i = 0; i < rangeArg.getValue().size(); i++)
+        {
+            genomicRange R;
+            if (!R.parse(rangeArg.getValue()[i]))
+            {
+                cout << "Region " << rangeArg.getValue()[i] << " is not chr:start-end. Exit program!" << endl;
+                exit(1);
+            }
+            GLOBAL.ranges.push_back(R);
+            LOG << "Analyse region: " << rangeArg.getValue()[i] << endl;
         }
         cout << "Reading genotype file..." << endl;
         readGenoFile(GLOBAL, LOG);
@@ -370,11 +816,12 @@ int main (int argc,  char * argv[])
     return 0;
 }
 
+// Marker list file: first word of every line is a marker id (rsid or SNPID) or chromosome:position
 bool
-readExclFile(global & G, ofstream & LOG)
+readMarkerList(global & G, const string & fileName, idSet & markers, const string & listName, ostream & LOG)
 {
     int lineNr = 0;
-    ifstream F (G.inputExclFile.c_str());
+    ifstream F (fileName.c_str());
     if (F.is_open())
     {
        	while (! F.eof() )
@@ -382,24 +829,59 @@ readExclFile(global & G, ofstream & LOG)
 	        string line;
         	vector<string> tokens;
         	getline (F,line);
-			string currentmarker = "";
 			int n = Tokenize(string(line), tokens, " ");		//tabulating file by space
 			if (n>0)
 			{
-                G.exclusionList[string(tokens[0])]= true;
+                markers.insert(tokens[0]);
 			}
             lineNr++;
 		}
     }
     else
-    {cout << "Cannot exclusion list file. Exit program!" << endl;exit(1);}
-    if (G.debugMode)cout << "Exclusion list contained: " << lineNr << " markers" << endl;
-    LOG << "Exclusion list contained: " << lineNr << " markers" << endl;
+    {cout << "Cannot read marker list file " << fileName << ". Exit program!" << endl;exit(1);}
+    if (G.debugMode)cout << listName << " list contained: " << lineNr << " markers" << endl;
+    LOG << listName << " list contained: " << lineNr << " markers" << endl;
     return true;
 }
 
+// True if a marker is excluded, or neither in the inclusion list nor in a region when there
+// are any. The marker is looked up by both of its ids and by chromosome:position.
+bool
+skipMarker(const global & G, string_view id1, string_view id2, string_view chromosome, string_view pos)
+{
+    bool selecting = !G.inclusionList.empty() || !G.ranges.empty();
+    if (G.exclusionList.empty() && !selecting) return false;
+
+    char buffer[256];
+    string_view chrPos;
+    if (chromosome.size() + pos.size() + 1 <= sizeof(buffer))
+    {
+        memcpy(buffer, chromosome.data(), chromosome.size());
+        buffer[chromosome.size()] = ':';
+        memcpy(buffer + chromosome.size() + 1, pos.data(), pos.size());
+        chrPos = string_view(buffer, chromosome.size() + pos.size() + 1);
+    }
+    if (!G.exclusionList.empty())
+    {
+        if (G.exclusionList.contains(id1) || G.exclusionList.contains(id2)) return true;
+        if (chrPos.size() && G.exclusionList.contains(chrPos)) return true;
+    }
+    if (selecting)
+    {
+        if (G.inclusionList.contains(id1) || G.inclusionList.contains(id2)) return false;
+        if (chrPos.size() && G.inclusionList.contains(chrPos)) return false;
+        uint32_t position;
+        if (!G.ranges.empty() && from_chars(pos.data(), pos.data() + pos.size(), position).ec == errc())
+        {
+            for (int i = 0; i < G.ranges.size(); i++) if (G.ranges[i].contains(chromosome, position)) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
 bool
-readSampleFile(global & G, ofstream & LOG)
+readSampleFile(global & G, ostream & LOG)
 {
     int lineNr = 0;
     ifstream F (G.inputSampleFile.c_str());
@@ -407,7 +889,7 @@ readSampleFile(global & G, ofstream & LOG)
     {
         vector <string> columnNames;
         vector <int> phenoColumns;
-        vector <string> sampleNames;
+        vector <double> rows;       // phenotypes of every sample, until loaded into the table
         while (! F.eof() )
         {
             string line;
@@ -450,68 +932,328 @@ readSampleFile(global & G, ofstream & LOG)
             {
                 if (n>2)
                 {
-                    vector <double> _phenos;
-                    string _name = tokens[0];
-                    bool isOK=true;
+                    size_t first = rows.size();
                     bool _hasMissing = false;
                     for (int i = 0; i < phenoColumns.size(); i++)
                     {
-                        if (tokens[phenoColumns[i]] == G.missingCode){_phenos.push_back(-9999);_hasMissing=true;}
-                        else _phenos.push_back(atof(tokens[phenoColumns[i]].c_str()));
+                        if (tokens[phenoColumns[i]] == G.missingCode){rows.push_back(MISSING_PHENOTYPE);_hasMissing=true;}
+                        else rows.push_back(atof(tokens[phenoColumns[i]].c_str()));
                     }
                     if (G.removeMissing==true && _hasMissing==true)
                     {
-                        isOK=false;
-                        for (int i = 0; i < phenoColumns.size(); i++){_phenos[i]=-9999;}
+                        for (int i = 0; i < phenoColumns.size(); i++){rows[first+i]=MISSING_PHENOTYPE;}
                     }
-                    sample _S;
-                    _S._name=_name;
-                    _S._phenos = _phenos;
-                    _S.isOK = isOK;
-                    G.samples.push_back(_S);
-                    /*if (G.debugMode) cout << _name << ":\t";
-                    for (int j = 0; j<G.phenoList.size(); j++)
-                    {
-                      if (G.debugMode)cout << _phenos[j] << "\t";
-                    }
-                    if (G.debugMode)cout << endl;
-                    */
                 }
             }
             lineNr++;
         }
-				// cout << "sample size: " << G.samples.size() << endl;
+        G.phenotypes.load(rows, (int) G.phenoList.size());
     }
     else
     {cout << "Cannot read sample file. Exit program!" << endl;exit(1);}
     if (G.debugMode)cout << "Altogether: " << G.phenoList.size() << " phenos" << endl;
-    if (G.debugMode)cout << "Altogether: " << G.samples.size() << " samples" << endl;
+    if (G.debugMode)cout << "Altogether: " << G.phenotypes.sampleCount() << " samples" << endl;
     LOG << "Sample file contained all: " << G.phenoList.size() << " phenotypes" << endl;
-    LOG << "Sample file contained: " << G.samples.size() << " samples" << endl;
+    LOG << "Sample file contained: " << G.phenotypes.sampleCount() << " samples" << endl;
     return true;
 }
 
+// MAF, info score and allele orientation of a variant from its genotype counts V.aa, V.aA, V.AA
+// and the info score term fijeij, the same for all genotype file formats.
+// Returns true if the variant passes QC.
 bool
-readGenoFile(global & G, ofstream & LOG)
+variantQC(const global & G, variant & V, double fijeij)
 {
-    ofstream OUT (G.outputResult.c_str());
-    ofstream BETAS (G.outputBetas.c_str());
+    double aa = V.aa; double aA = V.aA; double AA = V.AA;
 
-    if (!G.printCovariance)
-    OUT << "Chromosome\tPosition\tMarkerName\tEffectAllele\tOtherAllele\tInfoScore\tHWE\tMAF\tN\tAA\tAB\tBB\tPhenotypeCount\tMask\tLogLikelihood\tnullLogLikelihood\tLikelihoodRatio\tP-value\tBIC\tBICnull\tModel\tsortedModel\n";
-    else
+    // MAF - MINOR ALLELE FREQUENCY
+    double maf = 0;
+    if (aa+aA+AA>0)
+    {
+        maf = ((2*aa)+aA)/(2*(aa+aA+AA));
+    }
+
+    // Minor allele is the effect allele
+    V.firstIsMajorAllele = false;
+    if (maf>0.5)
+    {
+        maf=1-maf;
+        V.firstIsMajorAllele=true;
+    }
+    if (G.debugMode)cout<<"MAF: "<< maf <<endl;
+    V.maf = maf;
+
+    if (!(maf>0)) return false; //marker is ok - Sham'st thou to show thy dangerous brow by night, When evils are most free?
+
+    // INFO SCORE
+    //info score calculation according to the measure in snptest:
+    //https://mathgen.stats.ox.ac.uk/genetics_software/snptest/snptest.v2.pdf
+    V.infoscore = 1-(fijeij/(2*(aa+aA+AA)*maf*(1-maf)));
+    return V.infoscore >= G.threshold;
+}
+
+void
+analyseVariant(const global & G, const maskModels & MM, variant & V, ostream & OUT, ostream & BETAS, ostream & LOG)
+{
+    int chr = V.chr;
+    int pos = V.pos;
+    string & markerName = V.markerName;
+    string & effectAllele = V.effectAllele;
+    string & nonEffectAllele = V.nonEffectAllele;
+    double infoscore = V.infoscore;
+    double maf = V.maf;
+    double aa = V.aa; double aA = V.aA; double AA = V.AA;
+    bool firstIsMajorAllele = V.firstIsMajorAllele;
+    string hwe;                         // same for every model row
+    double hweP = 0;
+    bool hweNA = false;
+    if (G.binaryOutput) hweNA = !HWEtest(aa, aA, AA, hweP);
+    else hwe = HWE(aa, aA, AA);
+
+    // Rows are built in reused strings and written in one piece, without flushing
+    static thread_local string row, bestModelString, bestBetasString;
+    bestModelString.clear();
+    bestBetasString.clear();
+
+    // Binary rows are added to the block of the variant, the row of the best model is kept aside
+    static thread_local string binaryBlock, binaryBest;
+    static thread_local vector <double> binaryExtra;
+    uint32_t binaryRows = 0;
+    if (G.binaryOutput)
+    {
+        resultFile::beginVariant(binaryBlock, V, hweNA, hweP);
+        binaryBest.clear();
+    }
+
+    double bestModel = 1e200;
+    static thread_local maskFit F;  // reused by every mask and variant of the thread
+
+    // One pass over the samples gives the sums needed by every mask
+    static thread_local patternStats S;
+    MM.accumulate(V.dose, S);
+
+    //lets run through all possible combinations of phenotypes
+    int _testcount = pow(2,G.phenoList.size()); // Number of tests is 2 to the power of phenotypes being tested
+    for (int m = 0; m < MM.models.size(); m++)
+    {
+        const maskModel & M = MM.models[m];
+        int test = M.test;
+        int _phenoCount = M.phenoCount;
+        const vector<bool> & phenoMask = M.phenoMask;
+
+        if (G.debugMode)
+        {
+            cout << "Current mask: ";
+            for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){cout<<"1";}else{cout<<"0";}}
+            cout << endl;
+        }
+
+        // LINEAR REGRESSION
+        if (MM.fit(M, S, F) && test!=_testcount)
+        {
+            int _sampleCount = F.sampleCount;
+            if (G.debugMode)cout << "test: " << test << " indcount: " << _sampleCount << " phenocount: " <<   _phenoCount << endl;
+
+            // LOGLIKELIHOOD - TEST & NULL
+            double testLogLikelihood = F.testLogLikelihood;
+            double nullLogLikelihood = F.nullLogLikelihood;
+            if (G.debugMode){cout << "Linear regression done with model: " << test << endl;}
+
+            if (G.debugMode)
+            {
+                for (int k = 0; k<=_phenoCount;k++)
+                {
+                    double _pPheno = (1-studenttdistribution((_sampleCount) - _phenoCount,ddabs(F.Cstat[k]/F.SECstat[k])))*2;
+                    cout << k << "\t" << (_sampleCount) << "\t" << _phenoCount << "\t" << F.Cstat[k] <<  "\t" << F.SECstat[k] << "\t" << _pPheno << endl;
+                }
+            }
+
+            // LIKELIHOOD RATIO
+            double likelihoodRatio = 2 * (testLogLikelihood - nullLogLikelihood);
+
+            // BIC and BIC NULL
+            double _BIC = (-2 * testLogLikelihood) + ((_phenoCount+1) * log(_sampleCount));
+            double _BICnull = (-2 *nullLogLikelihood) + (log(_sampleCount));
+
+            // P MODEL
+            double _pModel;
+            if (ddabs(likelihoodRatio)>0){_pModel = 1-chisquaredistribution(_phenoCount,ddabs(likelihoodRatio));}
+            else {_pModel = NAN;}
+
+            if (G.debugMode){cout << "Likelihood: " << testLogLikelihood << endl;}
+            if (G.debugMode){cout << "nullLikelihood: " << nullLogLikelihood << endl;}
+            if (G.debugMode){cout << "Model likelihood ratio: " << likelihoodRatio << endl;}
+            if (G.debugMode){cout << "Model p: " << _pModel << endl;}
+
+            int N = _phenoCount+1;
+
+            uint32_t binaryMask = 0;
+            double binaryStats[6] = {testLogLikelihood, nullLogLikelihood, likelihoodRatio, _pModel, _BIC, _BICnull};
+            if (G.binaryOutput)
+            {
+                for (int i = 0; i < phenoMask.size(); i++) if (phenoMask[i]) binaryMask |= 1u << i;
+                binaryExtra.clear();
+                if (G.printCovariance)
+                {
+                    for (int i = 1; i < N ;i++) {binaryExtra.push_back(F.Cstat[i]); binaryExtra.push_back(F.SECstat[i]);}
+                    for (int i = 1; i < N;i++)
+                        for (int j = i; j < N;j++) binaryExtra.push_back(F.covariance[i*N+j]);
+                }
+            }
+
+            // PRINT OUT RESULTS
+
+            // BAYESIAN INFORMATION SCORE
+            if (_BIC < bestModel)
+            {
+                bestModelString.clear();
+                bestBetasString.clear();
+                textRow line(bestModelString), line2(bestBetasString);
+                if (G.binaryOutput)
+                {
+                    binaryBest.clear();
+                    resultFile::addModel(binaryBest, binaryMask, _sampleCount, binaryStats, binaryExtra.data(), (int) binaryExtra.size());
+                }
+                else
+                {
+                    line << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" << infoscore << "\t" << hwe << "\t" <<maf << "\t" << _sampleCount << "\t";
+                    if (firstIsMajorAllele){line << AA << "\t" << aA << "\t" << aa;}
+                    else {line << aa << "\t" << aA << "\t" << AA;}
+
+                    line << "\t" << _phenoCount << "\t";
+
+                    for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){line<<"1";}else{line<<"0";}}
+
+                    line << "\t" << testLogLikelihood<<  "\t" <<  nullLogLikelihood <<
+                    "\t" << likelihoodRatio << "\t" << _pModel << "\t" << _BIC << "\t" << _BICnull << "\t";
+
+                    line << M.model << "\t" << M.sortedModel;
+
+                    if (G.printCovariance)
+                    {
+                        for (int i = 1; i < N ;i++) line << "\t" << F.Cstat[i] << "\t" <<F.SECstat[i];
+                        for (int i = 1; i < N;i++)
+                        {
+                            for (int j = i; j < N;j++)
+                                line << "\t" << F.covariance[i*N+j];
+                        }
+                    }
+
+                    line << '\n';
+                }
+
+                int k=1;
+                for (int i = 0; i < phenoMask.size(); i++)
+                {
+                    if (phenoMask[i])
+                    {
+                        line2 << markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" <<  _sampleCount << "\t" << M.model;
+                        line2  << "\t" << G.phenoList[i] << "\t" << F.Cstat[k] << "\t" << F.SECstat[k] << '\n';
+                        k++;
+                    }
+                }
+                bestModel = _BIC;
+            }
+            if (G.printAll || G.printComplex)
+            {
+                if (G.binaryOutput)
+                {
+                    resultFile::addModel(binaryBlock, binaryMask, _sampleCount, binaryStats, binaryExtra.data(), (int) binaryExtra.size());
+                    binaryRows++;
+                }
+                else
+                {
+                    row.clear();
+                    textRow out(row);
+                    out << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" << infoscore << "\t" << hwe << "\t" <<maf << "\t" << _sampleCount << "\t";
+                    if (firstIsMajorAllele){out << AA << "\t" << aA << "\t" << aa;}
+                    else {out << aa << "\t" << aA << "\t" << AA;}
+
+                    out << "\t" << _phenoCount << "\t";
+                    for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){out<<"1";}else{out<<"0";}}
+                    out << "\t" << testLogLikelihood <<  "\t" <<  nullLogLikelihood <<
+                    "\t" << likelihoodRatio << "\t" << _pModel << "\t" << _BIC << "\t" << _BICnull << "\t";
+                    out << M.model << "\t" << M.sortedModel;
+                    if (G.printCovariance)
+                    {
+                        for (int i = 1; i < N ;i++) out << "\t" << F.Cstat[i] << "\t" <<F.SECstat[i];
+                        for (int i = 1; i < N;i++)
+                        {
+                            for (int j = i; j < N;j++)
+                                out << "\t" << F.covariance[i*N+j];
+                        }
+                    }
+
+                    out << '\n';
+                    OUT << row;
+                }
+                row.clear();
+                textRow betas(row);
+                int k=1;
+                for (int i = 0; i < phenoMask.size(); i++)
+                {
+                    if (phenoMask[i])
+                    {
+                        if (G.printBetas) betas << markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" <<  _sampleCount << "\t" << M.model
+                            << "\t" << G.phenoList[i] << "\t" << F.Cstat[k] << "\t" << F.SECstat[k] << '\n';
+                        k++;
+                    }
+                }
+                if (G.printBetas) BETAS << row;
+            }
+        }
+        else
+        {
+            if (test!=_testcount) LOG << "Collinearity problem with model: " << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << test << " " << _testcount << " ";
+            LOG << M.model;
+            if (F.rank < _phenoCount + 1) LOG << "\trank " << F.rank << " of " << _phenoCount + 1;
+            LOG << '\n';
+        }
+        if (G.printComplex){break;}
+    }
+
+    if (!G.printAll && !G.printComplex)
     {
-        OUT << "Chromosome\tPosition\tMarkerName\tEffectAllele\tOtherAllele\tInfoScore\tHWE\tMAF\tN\tAA\tAB\tBB\tPhenotypeCount\tMask\tLogLikelihood\tnullLogLikelihood\tLikelihoodRatio\tP-value\tBIC\tBICnull\tModel\tsortedModel";
-        for (int i = 0; i < G.phenoList.size();i++) OUT << "\tbeta_" << i+1 << "\tse_" << i+1;
-        for (int i = 0; i < G.phenoList.size();i++)
+        if (G.printBetas)BETAS << bestBetasString;
+        if (!G.binaryOutput) OUT << bestModelString;
+        else if (!binaryBest.empty())
         {
-            for (int j = i; j < G.phenoList.size();j++)
-                OUT << "\tcov_" << i+1 << "_" << j+1;
+            binaryBlock += binaryBest;
+            binaryRows = 1;
         }
-        OUT << endl;
     }
+    if (G.binaryOutput && binaryRows)
+    {
+        resultFile::endVariant(binaryBlock, binaryRows);
+        OUT << binaryBlock;
+    }
+}
+
+bool
+readGenoFile(global & G, ostream & LOG)
+{
+    // Output is written in large blocks, rows end without flushing; compression runs on background threads
+    outputFile OUT;
+    outputFile BETAS;
+    if (!OUT.open(G.outputResult, G.compression, G.threads) || !BETAS.open(G.outputBetas, G.compression, G.threads))
+    {
+        cout << "Cannot create output files " << G.outputResult << " and " << G.outputBetas << ". Exit program!" << endl;
+        exit(1);
+    }
+
+    if (G.binaryOutput) resultFile::writeHeader(OUT, G.phenoList, G.printCovariance);
+    else OUT << resultFile::textHeader(G.phenoList, G.printCovariance);
     if (G.printBetas)BETAS << "MarkerName\tEffectAllele\tOtherAllele\tN\tModel\tModel_member\tbeta\tse\n";
 
+    // Phenotype part of every model is the same for all variants
+    maskModels MM;
+    MM.init(G.phenotypes, G.phenoList);
+
+    // Variants are read here and analysed by the pool, results are written in file order
+    variantPool POOL(G.threads, G.queueDepth,
+        [&G, &MM](variant & V, ostream & O, ostream & B, ostream & L){analyseVariant(G, MM, V, O, B, L);},
+        OUT, BETAS, LOG);
+
 		// READING BGEN FILE
 		if (G.inputGenFile.substr(G.inputGenFile.length()-4)=="bgen")
 		{
@@ -521,14 +1263,135 @@ readGenoFile(global & G, ofstream & LOG)
 				BgenParser bgenParser(filename) ;
 
 				// To store what's given by the function read_variant()
-				string chromosome ;
+				string_view chromosome ;
 				uint32_t position ;
-				string rsid ;
-				vector<string> alleles ;
-				vector<vector<double>> probs ;
+				string_view rsid ;
+				string_view SNPID ;
+				vector<string_view> alleles ;
+				DosageData dosage ;
+				variant V ;
+
+				// Variant fields needed after its probabilities are decoded
+				struct bgenMarker {
+					int chr, pos ;
+					string markerName, effectAllele, nonEffectAllele ;
+					bool biallelic ;
+					size_t begin, end ;		// compressed probabilities in bgenBatch::data
+				} ;
+
+				// Checks the decoded probabilities and hands a variant passing QC to emit; false if the sample count does not match
+				auto analyseMarker = [&G]( bgenMarker const& M, DosageData& dosage, variant& V, ostream& SCREEN, function< void( variant& ) > const& emit ) {
+					double callrate=0;
+					double ok_gen=dosage.valid; double not_ok_gen=dosage.invalid;
+
+					if (ok_gen+not_ok_gen!=G.phenotypes.sampleCount())
+					{
+							SCREEN << "The number of samples in genotype file (" << ok_gen+not_ok_gen << ") does not match the number of samples in sample file (" << G.phenotypes.sampleCount() << "). Exit program!" << endl;
+							return false;
+					}
+
+					// CALL RATE
+					callrate = ok_gen/(ok_gen+not_ok_gen);
+					if (G.debugMode)SCREEN<<"Callrate: "<< callrate <<endl;
+
+					// MAF, INFO SCORE
+					V.aa = dosage.aa; V.aA = dosage.aA; V.AA = dosage.AA;
+					if (variantQC(G, V, dosage.fijeij))
+					{
+							// DOSAGE OF EFFECT ALLELE FOR EACH SAMPLE
+							V.chr = M.chr; V.pos = M.pos; V.markerName = M.markerName;
+							V.effectAllele = M.effectAllele; V.nonEffectAllele = M.nonEffectAllele;
+							if (V.firstIsMajorAllele && M.biallelic) swap(V.effectAllele, V.nonEffectAllele);
+							// (missing probabilities are left at zero dosage by DosageSetter)
+							if (V.firstIsMajorAllele) V.dose = dosage.firstDose;
+							else V.dose = dosage.dose;
+							emit(V);
+					}
+					return true;
+				} ;
+
+				// With several threads the compressed probabilities of a batch of variants are copied to a task,
+				// so that uncompressing and decoding runs on the workers. The pool hands a batch back once its task is done.
+				struct bgenBatch {
+					vector< bgenMarker > markers ;
+					vector< genfile::byte_t > data ;
+					vector< genfile::byte_t > buffer ;	// working space of the worker
+					DosageData dosage ;
+					variant V ;
+				} ;
+				shared_ptr< bgenBatch > batch ;
+				atomic< bool > bgenFailed( false ) ;
+				genfile::bgen::Context const& context = bgenParser.context() ;
+				auto submitBatch = [&]() {
+					bgenBatch* filled = batch.get() ;
+					POOL.submit( [&G, &MM, &analyseMarker, &bgenFailed, &context, batch = filled]( ostream& O, ostream& B, ostream& LG, ostream& SCREEN ) {
+						auto analyse = [&]( variant& V ) { analyseVariant( G, MM, V, O, B, LG ) ; } ;
+						try {
+							for( size_t i = 0; i < batch->markers.size(); ++i ) {
+								bgenMarker const& M = batch->markers[i] ;
+								BgenParser::decode_probs( context, &batch->data[0] + M.begin, &batch->data[0] + M.end, &batch->buffer, &batch->dosage ) ;
+								if( !analyseMarker( M, batch->dosage, batch->V, SCREEN, analyse ) ) return false ;
+							}
+						}
+						catch( genfile::bgen::BGenError const& e ) {
+							bgenFailed = true ;
+							return false ;
+						}
+						return true ;
+					}, move( batch ) ) ;
+				} ;
+
+				// With an inclusion list or regions only the selected variants are read, found through the variant index
+				vector< uint64_t > selected ;
+				size_t nextSelected = 0 ;
+				bool useIndex = false ;
+				if( !G.inclusionList.empty() || !G.ranges.empty() ) {
+					bgenIndex index ;
+					if( !index.load( filename ) ) {
+						cout << "Building variant index of " << filename << "..." << endl ;
+						if( index.build( filename ) && !index.save( filename ) ) {
+							LOG << "Cannot write variant index " << bgenIndex::fileName( filename ) << ", it is rebuilt on every run" << endl ;
+						}
+					}
+					if( index.size() ) {
+						index.select( [&G]( string_view chromosome, uint32_t position, string_view rsid, string_view SNPID ) {
+							char positionText[16] ;
+							string_view positionView( positionText, to_chars( positionText, positionText + sizeof( positionText ), position ).ptr - positionText ) ;
+							return !skipMarker( G, rsid, SNPID, chromosome, positionView ) ;
+						}, selected ) ;
+						useIndex = true ;
+						LOG << "Variant index: " << selected.size() << " of " << index.size() << " variants selected" << endl ;
+					}
+				}
+				auto nextVariant = [&]() {
+					if( useIndex ) {
+						if( nextSelected == selected.size() ) return false ;
+						bgenParser.seek( selected[nextSelected++] ) ;
+					}
+					return bgenParser.read_variant( &chromosome, &position, &rsid, &alleles, &SNPID ) ;
+				} ;
 
 				// VARIANT
-		    while( bgenParser.read_variant( &chromosome, &position, &rsid, &alleles )){
+		    while( nextVariant() ){
+
+					// Excluded markers are skipped without decompressing their data
+					char positionText[16];
+					string_view positionView(positionText, to_chars(positionText, positionText + sizeof(positionText), position).ptr - positionText);
+					if (skipMarker(G, rsid, SNPID, chromosome, positionView))
+					{
+						bgenParser.ignore_probs();
+						continue;
+					}
+					if (POOL.failed()) break;
+
+					bgenMarker single ;
+					if (G.threads > 1 && !batch) {
+						batch = static_pointer_cast< bgenBatch >( POOL.spareBuffer() ) ;
+						if( !batch ) batch = make_shared< bgenBatch >() ;
+						batch->markers.clear() ;
+						batch->data.clear() ;
+					}
+					bgenMarker& M = batch ? ( batch->markers.push_back( bgenMarker() ), batch->markers.back() ) : single ;
 
 					// CHROMOSOME
 					int chr; // To be printed out in debug mode
@@ -536,425 +1399,54 @@ readGenoFile(global & G, ofstream & LOG)
 					else if (chromosome=="XY") chr=25;
 					else if (chromosome=="Y" or chromosome == "0Y") chr=24; // Have to specify "0X" and "0Y" for some syntax variation
 					else if (chromosome=="X" or chromosome == "0X") chr=23;
-					else chr = atoi(chromosome.c_str());
+					else chr = atoi(string(chromosome).c_str());
 
 					if (G.chr)chr=G.chr;
 					if (G.debugMode) cout << "Chromosome id: " << chr;
+					M.chr = chr;
 
 					// POSITION, MARKER
-					int pos =  (int) position;
-					string markerName = rsid;
+					M.pos = (int) position;
+					M.markerName = rsid;
 					if (G.debugMode) cout << "Pos: " << position << "\nmarker:" << rsid;
 
 					// EFFECT & NON-EFFECT ALLELES
-					string effectAllele;
-					string nonEffectAllele;
-					if (alleles.size() == 2) // By default
+					M.biallelic = alleles.size() == 2;
+					M.effectAllele.clear();
+					M.nonEffectAllele.clear();
+					if (M.biallelic) // By default
 					{
-						effectAllele = alleles[1];
-						nonEffectAllele = alleles[0];
+						M.effectAllele = alleles[1];
+						M.nonEffectAllele = alleles[0];
 					}
-					if (G.debugMode) cout << "\nea/nea:" << effectAllele <<"/" << nonEffectAllele<<"\n";
+					if (G.debugMode) cout << "\nea/nea:" << M.effectAllele <<"/" << M.nonEffectAllele<<"\n";
 
 					// PROBABILITIES
-					// Initialise variables
-					vector <double> gen;
-					vector <double> gen2;
-					int j = 0;
-					double aa=0; double aA=0; double AA=0;
-					double callrate=0; double ok_gen=0; double not_ok_gen=0;
-					double bestModel = 1e200;
-					string bestModelString = "";
-					string bestBetasString = "";
-					double fijeij = 0; //for infoscore
-					double infoscore = 1;
-					double eij = 0; double fij = 0;
-
-					// Read probability
-					bgenParser.read_probs(&probs);
-
-					for (size_t i = 0; i < probs.size(); ++i)
+					if (batch)
 					{
-							// granvil copypaste, adapted for BGEN
-							if(probs[i][0]+probs[i][1]+probs[i][2] == 1) // Check that probability values are valid
-							{
-								// Add genotype counts
-								aa+=probs[i][0];
-								aA+=probs[i][1];
-								AA+=probs[i][2];
-
-								// Add probabilities of each allele
-								gen2.push_back((((probs[i][2])*2) + (probs[i][1])));
-								gen.push_back(((probs[i][0]*2) + (probs[i][1])));
-
-								// To calculate call rate
-								ok_gen++;
-
-								// To calculate info score
-								double eij=(2*(probs[i][2])) + (probs[i][1]);
-								double fij = (4*(probs[i][2])) + (probs[i][1]);
-								fijeij+= fij - (eij*eij);
-
-							}
-							else
-							{
-								// To calculate call rate
-								not_ok_gen++;
-							}
-					}
-
-					if (ok_gen+not_ok_gen!=G.samples.size())
-					{
-							cout << "The number of samples in genotype file (" << ok_gen+not_ok_gen << ") does not match the number of samples in sample file (" << G.samples.size() << "). Exit program!" << endl;
-							exit (1);
-					}
-
-					// CALL RATE
-					callrate = ok_gen/(ok_gen+not_ok_gen);
-					if (G.debugMode)cout<<"Callrate: "<< callrate <<endl;
-
-					// MAF - MINOR ALLELE FREQUENCY
-					double maf = 0;
-					if (aa+aA+AA>0)
-					{
-							maf = ((2*aa)+aA)/(2*(aa+aA+AA));
+						// Copied for the worker, which decodes the batch when it is full
+						genfile::byte_t const* begin ;
+						genfile::byte_t const* end ;
+						bgenParser.read_compressed_probs( &begin, &end ) ;
+						M.begin = batch->data.size() ;
+						batch->data.insert( batch->data.end(), begin, end ) ;
+						M.end = batch->data.size() ;
+						if (batch->markers.size() == BGEN_BATCH) submitBatch() ;
+						continue;
 					}
 
-					// INFO SCORE
-					if (maf==0){infoscore=1;}
-					//info score calculation according to the measure in snptest:
-					//https://mathgen.stats.ox.ac.uk/genetics_software/snptest/snptest.v2.pdf
-					else
-					{
-							infoscore = 1-(fijeij/(2*(aa+aA+AA)*maf*(1-maf)));
-					}
-
-					// Update major & minor allele based on MAF
-					bool firstIsMajorAllele = false;
-					if (maf>0.5)
-					{
-							maf=1-maf;
-							firstIsMajorAllele=true;
-							if (alleles.size() == 2){
-								effectAllele = alleles[0];
-								nonEffectAllele = alleles[1];
-							}
-					}
-					if (G.debugMode)cout<<"MAF: "<< maf <<endl;
-
-					if (maf>0) //marker is ok - Sham'st thou to show thy dangerous brow by night, When evils are most free?
-					{
-								// INFO SCORE (may be redundant)
-								infoscore = 1-(fijeij/(2*(aa+aA+AA)*maf*(1-maf)));
-
-								if (infoscore >= G.threshold)
-								{
-										// CREATE MAIN MATRIX
-										unsigned int _rows = probs.size();
-										unsigned int _cols = (unsigned int) G.phenoList.size()+1;
-										if (G.debugMode)cout << "Mainmatrix x: " << _rows << " y: " <<  _cols << endl;
-										matrixD _mainmatrix(_rows, _cols); //[0]-Y(0,1,2,3); [1]-.. X1,X2,X3...
-										int curind=0;
-
-										// FILL MAIN MATRIX
-										// For each sample (triplet of probabilities)
-										for (int i = 0; i < probs.size(); i++)
-										{
-											if( probs[i][j] == -1 ) {}
-											else{
-												// DEPOSIT THE MAJOR ALLELE FREQUENCY IN THE RESPECTIVE SAMPLE ROW & FIRST COLUMN
-												if (firstIsMajorAllele)
-												{
-														_mainmatrix.put(curind,0,2*probs[i][0]+probs[i][1]);
-												}
-												else
-												{
-														_mainmatrix.put(curind,0,2*probs[i][2]+probs[i][1]);
-												}
-											}
-												// FOR EACH PHENOTYPE
-												for (int j = 0; j<G.phenoList.size(); j++)
-												{
-														string xxy = G.samples[curind]._name; // PHENOTYPE
-														_mainmatrix.put(curind,j+1,G.samples[curind]._phenos[j]); // THE NEXT 2 OR MORE COLUMNS CONTAIN THE VALUES OF THE PHENOTYPES
-												}
-
-												// MOVE TO THE NEXT SAMPLE
-												curind++;
-
-										}
-
-									//We have main table now - lets run through all possible combinations of phenotypes
-									//if (G.debugMode)_mainmatrix.print();
-
-									int _testcount = pow(2,G.phenoList.size()); // Number of tests is 2 to the power of phenotypes being tested
-									for (int test=_testcount-1; test>=1; test--)
-									{
-										int _phenoCount = 0;
-										int _sampleCount = 0;
-										vector<bool> phenoMask = phenoMasker(test,(int)G.phenoList.size());
-
-										if (G.debugMode)cout << "Current mask: ";
-										for (int i = 0; i < phenoMask.size(); i++)
-										{
-												if (phenoMask[i])
-												{
-														_phenoCount++;
-														if (G.debugMode)cout<<"1";
-												}
-												else{if (G.debugMode)cout<<"0";}
-										}
-										if (G.debugMode)cout << endl;
-
-										for (int i = 0; i<_mainmatrix.getRows(); i++)
-										{
-												bool indISOK = true;
-												if (G.debugMode){cout << G.samples[i]._name;}
-												if (_mainmatrix.get(i,0)==-9999){indISOK=false;}
-
-												for (int j = 1; j<_mainmatrix.getCols(); j++)
-												{
-
-														//phenotypes
-														if (phenoMask[j-1]){
-																//if (i==0)_phenoCount++;
-																if (_mainmatrix.get(i,j)==-9999){indISOK=false;}
-														}
-														if (G.debugMode){cout << " " << _mainmatrix.get(i,j);}
-
-												}
-												if (G.debugMode){cout << endl;}
-
-												if (indISOK)_sampleCount++;
-										}
-										if (G.debugMode)cout << "test: " << test << " indcount: " << _sampleCount << " phenocount: " <<   _phenoCount << endl;
-
-										// CREATE NEW MATRICES
-										arrayD *Y = new arrayD ( _sampleCount );
-										matrixD *X = new matrixD ( _sampleCount, _phenoCount+1);
-										arrayD *W = new arrayD ( _sampleCount );
-										int curInd = 0;
-										vector <double> COPYpheno;
-
-										for (int i = 0; i<_mainmatrix.getRows(); i++)
-										{
-												bool indISOK = true;
-												if (_mainmatrix.get(i,0)==-9999){indISOK=false;}
-												for (int j = 1; j<_mainmatrix.getCols(); j++)
-												{
-
-														if (phenoMask[j-1]){
-																//if (i==0)_phenoCount++;
-																if (_mainmatrix.get(i,j)==-9999){indISOK=false;}
-														}
-												}
-												if (indISOK)
-												{
-														int z=1;
-
-														//genotype
-														Y->put(curInd, _mainmatrix.get(i,0));
-														COPYpheno.push_back(_mainmatrix.get(i,0));
-
-														W->put(curInd,1);
-														X->put(curInd, 0,  1.0);
-
-														for (int j = 1; j<_mainmatrix.getCols(); j++)
-														{
-																if (phenoMask[j-1])
-																{
-																		X->put(curInd, z, _mainmatrix.get(i,j));
-																		z++;
-																}
-														}
-														curInd++;
-												}
-
-										}
-
-										// LINEAR REGRESSION
-										lr LR;
-										try
-										{
-											if (LR.lr_w(Y, X, W) && test!=_testcount)
-											{
-												matrixD * C = LR.covariance;
-												C->InvertS();
-												double x;
-												for (int i=0; i<(unsigned int) _phenoCount;i++)
-														for (int j=0; j<(unsigned int) _phenoCount;j++)
-																x+=LR.Cstat->get(i)*LR.Cstat->get(j)*C->get(i,j);
-												double testLogLikelihood = -LR.getLnLk(Y, X, W)/2;
-												double nullLogLikelihood = -LR.nullLikelihood(COPYpheno)/2;
-												if (G.debugMode){cout << "Linear regression done with model: " << test << endl;}
-
-												for (int k = 0; k<=_phenoCount;k++)
-												{
-														double _pPheno = (1-studenttdistribution((_sampleCount*2) - _phenoCount,ddabs(LR.Cstat->get(k)/LR.SECstat->get(k))))*2;
-														if (G.debugMode){cout << k << "\t" << (_sampleCount*2) << "\t" << _phenoCount << "\t" << LR.Cstat->get(k) <<  "\t" << LR.SECstat->get(k) << "\t" << _pPheno << endl;}
-
-												}
-
-												double likelihoodRatio = 2 * (testLogLikelihood - nullLogLikelihood);
-												double _BIC = (-2 * testLogLikelihood) + ((_phenoCount+1) * log(_sampleCount));
-												double _BICnull = (-2 *nullLogLikelihood) + (log(_sampleCount));
-												double _pModel;
-												if (ddabs(likelihoodRatio)>0){_pModel = 1-chisquaredistribution(_phenoCount,ddabs(likelihoodRatio));}
-												else {_pModel = NAN;}
-
-												if (G.debugMode){cout << "Likelihood: " << testLogLikelihood << endl;}
-												if (G.debugMode){cout << "nullLikelihood: " << nullLogLikelihood << endl;}
-												if (G.debugMode){cout << "Model likelihood ratio: " << likelihoodRatio << endl;}
-												if (G.debugMode){cout << "Model p: " << _pModel << endl;}
-
-												std::stringstream line, line2;
-
-												if (_BIC < bestModel)
-												{
-
-														line << chr << "\t"<<  position << "\t" <<  rsid << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" << infoscore << "\t" << HWE(aa,aA,AA) << "\t" <<maf << "\t" << _sampleCount << "\t";
-														if (firstIsMajorAllele){line << AA << "\t" << aA << "\t" << aa;}
-														else {line << aa << "\t" << aA << "\t" << AA;}
-														line << "\t" << _phenoCount << "\t";
-
-														for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){line<<"1";}else{line<<"0";}}
-
-														line << "\t" << testLogLikelihood<<  "\t" <<  nullLogLikelihood <<
-														"\t" << likelihoodRatio << "\t" << _pModel << "\t" << _BIC << "\t" << _BICnull << "\t";
-
-														//bool phenostart = true;
-														//for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i] && phenostart){line<<G.phenoList[i];phenostart=false;}else if(phenoMask[i]){line << "+" <<G.phenoList[i];}}
-
-														vector<string> phenosorter;
-														for (int i = 0; i < phenoMask.size(); i++){if(phenoMask[i])phenosorter.push_back(G.phenoList[i]);}
-														bool phenostart = true;
-														for (int i = 0; i < phenosorter.size(); i++) {if (phenostart){line<<phenosorter[i];phenostart=false;}else{line << "+" <<phenosorter[i];}}
-														line << "\t";
-														sort(phenosorter.begin(),phenosorter.end());
-														phenostart = true;
-														for (int i = 0; i < phenosorter.size(); i++) {if (phenostart){line<<phenosorter[i];phenostart=false;}else{line << "+" <<phenosorter[i];}}
-
-														if (G.printCovariance)
-														{
-																for (int i = 1; i < LR.Cstat->size() ;i++) line << "\t" << LR.Cstat->get(i) << "\t" <<LR.SECstat->get(i);
-																for (int i = 1; i < LR.Cstat->size();i++)
-																{
-																		for (int j = i; j < LR.Cstat->size();j++)
-																				line << "\t" << LR.covariance->get(i,j);
-																}
-														}
-														line << endl;
-														bestModelString = line.str();
-
-														int k=1;
-														for (int i = 0; i < phenoMask.size(); i++)
-														{
-																if (phenoMask[i])
-																{
-																		line2 << rsid << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" <<  _sampleCount << "\t";
-																		bool phenostart = true;
-																		for (int j = 0; j < phenoMask.size(); j++)
-																		{
-																				if (phenoMask[j] && phenostart)
-																				{
-																						line2<<G.phenoList[j];
-																						phenostart=false;
-																				}
-																				else if(phenoMask[j])
-																				{
-																						line2 << "+" <<G.phenoList[j];
-																				}
-																		}
-																		line2  << "\t" << G.phenoList[i] << "\t" << LR.Cstat->get(k) << "\t" << LR.SECstat->get(k) << endl;
-																		k++;
-																}
-														}
-														bestBetasString = line2.str();
-														bestModel = _BIC;
-												}
-
-												if (G.printAll || G.printComplex)
-												{
-													OUT << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" << infoscore << "\t" << HWE(aa,aA,AA) << "\t" <<maf << "\t" << _sampleCount << "\t";
-													if (firstIsMajorAllele){OUT << AA << "\t" << aA << "\t" << aa;}
-													else {OUT << aa << "\t" << aA << "\t" << AA;}
-
-													OUT << "\t" << _phenoCount << "\t";
-													for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){OUT<<"1";}else{OUT<<"0";}}
-													OUT << "\t" << testLogLikelihood <<  "\t" <<  nullLogLikelihood <<
-													"\t" << likelihoodRatio << "\t" << _pModel << "\t" << _BIC << "\t" << _BICnull << "\t";
-
-													vector<string> phenosorter;
-													for (int i = 0; i < phenoMask.size(); i++){if(phenoMask[i])phenosorter.push_back(G.phenoList[i]);}
-													bool phenostart = true;
-													for (int i = 0; i < phenosorter.size(); i++) {if (phenostart){OUT<<phenosorter[i];phenostart=false;}else{OUT << "+" <<phenosorter[i];}}
-													OUT << "\t";
-													sort(phenosorter.begin(),phenosorter.end());
-													phenostart = true;
-													for (int i = 0; i < phenosorter.size(); i++) {if (phenostart){OUT<<phenosorter[i];phenostart=false;}else{OUT << "+" <<phenosorter[i];}}
-													if (G.printCovariance)
-													{
-															for (int i = 1; i < LR.Cstat->size() ;i++) OUT << "\t" << LR.Cstat->get(i) << "\t" <<LR.SECstat->get(i);
-															for (int i = 1; i < LR.Cstat->size();i++)
-															{
-																	for (int j = i; j < LR.Cstat->size();j++)
-																			OUT << "\t" << LR.covariance->get(i,j);
-															}
-													}
-
-													OUT << endl;
-
-													int k=1;
-													for (int i = 0; i < phenoMask.size(); i++)
-													{
-															if (phenoMask[i])
-															{
-																	if (G.printBetas) BETAS << markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" <<  _sampleCount << "\t";
-																	bool phenostart = true;
-																	for (int j = 0; j < phenoMask.size(); j++)
-																	{
-																			if (phenoMask[j] && phenostart)
-																			{
-																					if (G.printBetas) BETAS<<G.phenoList[j];
-																					phenostart=false;
-																			}
-																			else if(phenoMask[j])
-																			{
-																					if (G.printBetas) BETAS << "+" <<G.phenoList[j];
-																			}
-																	}
-																	if (G.printBetas) BETAS  << "\t" << G.phenoList[i] << "\t" << LR.Cstat->get(k) << "\t" << LR.SECstat->get(k) << endl;
-																	k++;
-															}
-													}
-												}
-											}
-
-											else
-											{
-													if (test!=_testcount) LOG << "Collinearity problem with model: " << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << test << " " << _testcount << " ";
-													bool phenostart = true;
-													for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i] && phenostart){LOG<<G.phenoList[i];phenostart=false;}else if(phenoMask[i]){LOG << "+" <<G.phenoList[i];}}
-													LOG << endl;
-											}
-										}
-										catch (ArgException &e)  // catch any exceptions
-										{ cerr << "error: " << e.error() << " for linear model " << e.argId() << endl; }
-
-										delete X;
-										delete Y;
-										delete W;
-										if (G.printComplex){break;}
-									}
-
-									if (!G.printAll && !G.printComplex)
-									{
-											if (G.printBetas)BETAS << bestBetasString;
-											OUT << bestModelString;
-									}
-								}
-					} //maf > 0 end (i think)
+					// Dosages and genotype sums of all samples, decoded in one pass
+					bgenParser.read_probs(&dosage);
+					if (!analyseMarker(M, dosage, V, cout, [&POOL](variant & V){POOL.submit(V);})) exit(1);
+				}
+				if (batch) submitBatch();
+				if (!POOL.finish())
+				{
+					if (bgenFailed) throw genfile::bgen::BGenError();
+					exit(1);
 				}
+				POOL.report(LOG);
+				if (!OUT.close() || !BETAS.close()) {cout << "Cannot write output files. Exit program!" << endl; exit(1);}
 				return 0;
 		}
 			catch( genfile::bgen::BGenError const& e )
@@ -967,565 +1459,244 @@ readGenoFile(global & G, ofstream & LOG)
 	//READING GEN FILE
     if (G.inputGenFile.substr(G.inputGenFile.length()-3)=="gen")
     {
-        ifstream F (G.inputGenFile.c_str());
-        if (F.is_open())
+        // Parsing state of one reader, reused for every marker
+        struct genState
         {
-            while (! F.eof() )
-            {
+            genLine L;                          // fields and probabilities of the current line
+            vector <double> dose, firstDose;    // dosages of second/first allele
+            variant V;
+        };
+
+        // Reads one line and hands a variant passing QC to emit; false if the sample count does not match
+        auto readMarker = [&G](genState & S, const char * lineBegin, const char * lineEnd, ostream & SCREEN, const function <void (variant &)> & emit)
+        {
+                genLine & L = S.L;
+                vector <double> & dose = S.dose;
+                vector <double> & firstDose = S.firstDose;
 				// PARSING INPUT GEN FILE
-                string line;
-                vector<string> tokens;
-                getline (F,line);
-                string currentmarker = "";
-                int n = Tokenize(string(line), tokens, " ");	// Tabulating file by space, returns count n; from tools.cpp
+                int n = L.parse(lineBegin, lineEnd, 6);	// Leading columns as views, probabilities as numbers
 
-                if (n>2 && !G.exclusionList[string(tokens[1])]) // Continue reading GEN file if it's not empty
+                if (n>5 && !skipMarker(G, L.fields[1], L.fields[2], L.fields[0], L.fields[3])) // Continue reading GEN file if it's not empty
                 {
 					// CHROMOSOME (token 0)
                     int chr;
+                    string chrName(L.fields[0]);
                   
-                  if (uc(tokens[0])=="MT") chr=26;
-                    else if (uc(tokens[0])=="XY") chr=25;
-                    else if (uc(tokens[0])=="Y") chr=24;
-                    else if (uc(tokens[0])=="X") chr=23;
-                    else chr = atoi(tokens[0].c_str());
+                  if (uc(chrName)=="MT") chr=26;
+                    else if (uc(chrName)=="XY") chr=25;
+                    else if (uc(chrName)=="Y") chr=24;
+                    else if (uc(chrName)=="X") chr=23;
+                    else chr = atoi(chrName.c_str());
                     if (G.chr)chr=G.chr;
 
                     if (G.chr)chr=G.chr;
-                    if (G.debugMode) cout << "Chromosome id: " << chr;
-                    cout << "Chromosome id: " << chr << endl;
-                    cout << "Chromosome id: " << tokens[0].c_str() << endl;
+                    if (G.debugMode) SCREEN << "Chromosome id: " << chr;
+                    SCREEN << "Chromosome id: " << chr << endl;
+                    SCREEN << "Chromosome id: " << chrName << endl;
 
 					// MARKER NAME (token 1)
-                    string markerName = string(tokens[1]);
+                    string markerName = string(L.fields[1]);
 
 					// POSITION (token 3)
-					int pos = atoi(tokens[3].c_str());
+					int pos = atoi(string(L.fields[3]).c_str());
 
 					// ALLELES (tokens 4 & 5)
-                    char effectAllele = tokens[5][0];
-                    char nonEffectAllele = tokens[4][0];
+                    char effectAllele = L.fields[5][0];
+                    char nonEffectAllele = L.fields[4][0];
 
-                    if (G.debugMode) cout << "Pos: " << pos << "\nmarker:" << markerName << "\nea/nea:" << effectAllele <<"/" << nonEffectAllele<<"\n";
+                    if (G.debugMode) SCREEN << "Pos: " << pos << "\nmarker:" << markerName << "\nea/nea:" << effectAllele <<"/" << nonEffectAllele<<"\n";
 
-					// INITIALISE VARIABLES FOR PROBABILITIES ANALYSIS
-                    vector <double> gen, gen2; // Frequency of each allele
-                    int j = 0;
+					// PROBABILITIES: one pass over the triplets of all samples gives the genotype
+					// counts, the info score terms and the dosages of both alleles
+                    int sampleCount = (n-6)/3;
                     double aa=0; double aA=0; double AA=0; // Frequency of each genotype
                     double callrate=0; double ok_gen=0; double not_ok_gen=0; // Variables to calculate call rate
-
-                    double bestModel = 1e200;
-                    string bestModelString = "";
-                    string bestBetasString = "";
-
                     double fijeij = 0; // For info score
-                    double infoscore = 1; // For info score
-
-					// Loop through each triplet of probabilities for each variant
-                    for (int i = 6; i < n; i+=3)
+                    dose.resize(sampleCount);
+                    firstDose.resize(sampleCount);
+                    const double * P = L.probs.data();
+                    for (int k = 0; k < sampleCount; k++, P+=3)
                     {
+                        double p0 = P[0];
+                        double p1 = P[1];
+                        double p2 = P[2];
+
 						// Cumulative addition to obtain genotype counts // granvil copypaste
-                        aa+=atof(tokens[i].c_str());
-                        aA+=atof(tokens[i+1].c_str());
-                        AA+=atof(tokens[i+2].c_str());
+                        aa+=p0;
+                        aA+=p1;
+                        AA+=p2;
 
-						// Store the frequency or probabilities of each allele
-                        gen2.push_back(((atof(tokens[i+2].c_str())*2) + atof(tokens[i+1].c_str()))); // A -> 2 from AA & 1 from aA
-                        gen.push_back(((atof(tokens[i].c_str())*2) + atof(tokens[i+1].c_str()))); // a -> 2 from aa & 1 from aA
+						// Dosage of each allele: A -> 2 from AA & 1 from aA, a -> 2 from aa & 1 from aA
+                        dose[k] = (p2*2) + p1;
+                        firstDose[k] = (p0*2) + p1;
 
 						// SNP information not missing for this sample
                         ok_gen++;
 
 						// To measure info score later
-                        double eij=(2*atof(tokens[i+2].c_str())) + atof(tokens[i+1].c_str());
-                        double fij = (4*atof(tokens[i+2].c_str())) + atof(tokens[i+1].c_str());
+                        double eij=(2*p2) + p1;
+                        double fij = (4*p2) + p1;
                         fijeij+= fij - (eij*eij);
-                        j++;
                     }
 
 					// CHECK SAMPLES IN GENOTYPE & PHENOTYPE FILES MATCH
-                    if (ok_gen+not_ok_gen!=G.samples.size())
+                    if (ok_gen+not_ok_gen!=G.phenotypes.sampleCount())
                     {
-                        cout << "The number of samples in genotype file (" << ok_gen+not_ok_gen << ") does not match the number of samples in sample file (" << G.samples.size() << "). Exit program!" << endl;
-                        exit (1);
+                        SCREEN << "The number of samples in genotype file (" << ok_gen+not_ok_gen << ") does not match the number of samples in sample file (" << G.phenotypes.sampleCount() << "). Exit program!" << endl;
+                        return false;
                     }
 
 					// CALL RATE - Proportion of individuals where SNP information is not missing
                     callrate = ok_gen/(ok_gen+not_ok_gen);
-                    if (G.debugMode)cout<<"Callrate: "<< callrate <<endl;
-
-					// MINOR ALLELE FERQUENCY
-                    double maf = 0;
-                    if (aa+aA+AA>0)
-                    {
-                        maf = ((2*aa)+aA)/(2*(aa+aA+AA));
-                    }
+                    if (G.debugMode)SCREEN<<"Callrate: "<< callrate <<endl;
 
-					// INFO SCORE
-                    if (maf==0){infoscore=1;}
-                    //info score calculation according to the measure in snptest:
-                    //https://mathgen.stats.ox.ac.uk/genetics_software/snptest/snptest.v2.pdf
-                    else
+					// MARKER PASSED MAF AND INFO SCORE
+                    variant & V = S.V;
+                    V.aa = aa; V.aA = aA; V.AA = AA;
+                    if (variantQC(G, V, fijeij))
                     {
-                        infoscore = 1-(fijeij/(2*(aa+aA+AA)*maf*(1-maf)));
+                        // DOSAGE OF EFFECT ALLELE FOR EACH SAMPLE
+                        V.chr = chr; V.pos = pos; V.markerName = markerName;
+                        if (V.firstIsMajorAllele) swap(effectAllele, nonEffectAllele);
+                        V.effectAllele = string(1, effectAllele); V.nonEffectAllele = string(1, nonEffectAllele);
+                        if (V.firstIsMajorAllele) V.dose = firstDose;
+                        else V.dose = dose;
+                        emit(V);
                     }
+                }
+                return true;
+        };
 
-					// SET MINOR ALLELE ACCORDING TO MAF
-                    bool firstIsMajorAllele = false;
-                    if (maf>0.5)
+        // Lines are parsed in place in the mapped file; streams are only used for what cannot be mapped
+        mappedFile M;
+        if (M.open(G.inputGenFile) && G.threads > 1)
+        {
+            // Newline aligned ranges are read and analysed by the workers of the pool
+            const char * data = M.data();
+            size_t size = M.size();
+            for (size_t begin = 0; begin < size && !POOL.failed(); )
+            {
+                size_t end = min(size, begin + GEN_CHUNK);
+                const char * eol = (const char *) memchr(data + end - 1, '\n', size - (end - 1));
+                end = eol ? eol - data + 1 : size;
+                M.willNeed(begin, end - begin);
+                const char * chunkBegin = data + begin;
+                const char * chunkEnd = data + end;
+                POOL.submit([&G, &MM, &readMarker, chunkBegin, chunkEnd](ostream & O, ostream & B, ostream & LG, ostream & SCREEN)
+                {
+                    genState S;
+                    auto analyse = [&](variant & V){analyseVariant(G, MM, V, O, B, LG);};
+                    for (const char * p = chunkBegin; p < chunkEnd; )
                     {
-                        maf=1-maf;
-                        firstIsMajorAllele=true;
-                        effectAllele = tokens[4][0];
-                        nonEffectAllele = tokens[5][0];
-                    }
-                    if (G.debugMode)cout<<"MAF: "<< maf <<endl;
-
-					// MARKER PASSED
-                    if (maf>0) //marker is ok - Sham'st thou to show thy dangerous brow by night, When evils are most free?
-                    {
-                        infoscore = 1-(fijeij/(2*(aa+aA+AA)*maf*(1-maf)));
-
-						// CREATE MAIN MATRIX
-                        if (infoscore>=G.threshold)
-                        {
-
-                            unsigned int _rows = (n-6)/3; // ROW = NUMBER OF SAMPLES
-                            unsigned int _cols = (unsigned int) G.phenoList.size()+1; // COLUMN = PHENOTYPES UNDER TEST + 1
-                            if (G.debugMode)cout << "Mainmatrix x: " << _rows << " y: " <<  _cols << endl;
-
-														// INITIALISE MAIN MATRIX
-                            matrixD _mainmatrix(_rows, _cols); //[0]-Y(0,1,2,3); [1]-.. X1,X2,X3...
-                            int curind=0; // Current index
-
-                            for (int i = 6; i < n-1; i+=3) // For each sample (triplet of probabilities)
-                            {
-								// DEPOSIT THE MAJOR ALLELE FREQUENCY IN THE RESPECTIVE SAMPLE ROW & FIRST COLUMN
-                                if (firstIsMajorAllele)
-                                {
-                                    _mainmatrix.put(curind,0,((atof(tokens[i].c_str())*2) + atof(tokens[i+1].c_str())));
-                                }
-                                else
-                                {
-                                    _mainmatrix.put(curind,0,((atof(tokens[i+2].c_str())*2) + atof(tokens[i+1].c_str())));
-                                }
-
-								// FOR EACH PHENOTYPE
-                                for (int j = 0; j<G.phenoList.size(); j++)
-                                {
-                                    string xxy = G.samples[curind]._name; // PHENOTYPE
-                                    _mainmatrix.put(curind,j+1,G.samples[curind]._phenos[j]); // THE NEXT 2 OR MORE COLUMNS CONTAIN THE VALUES OF THE PHENOTYPES
-                                }
-
-								// MOVE TO THE NEXT SAMPLE
-                                curind++;
-                            }
-								// _mainmatrix.print(); // TO BE COMMENTED OUT
-
-								// MAIN MATRIX READY FOR ANALYSIS
-                            	//We have main table now - lets run through all possible combinations of phenotypes
-                            	//if (G.debugMode)_mainmatrix.print();
-
-                            int _testcount = pow(2,G.phenoList.size()); // Number of tests is 2 to the power of phenotypes being tested
-
-							// LOOP THROUGH EACH TEST - each phenotype or combination of phenotypes
-                            for (int test=_testcount-1; test>=1; test--)
-                            {
-                                int _phenoCount = 0; // NUMBER OF PHENOTYPES
-                                int _sampleCount = 0; // NUMBER OF SAMPLES
-
-								// CREATE A PHENOMASK - given variant (current test - Ex: 3,2,1,0) & size (# of phenotypes)
-                                vector<bool> phenoMask = phenoMasker(test,(int)G.phenoList.size());
-                                if (G.debugMode)cout << "Current mask: ";
-                                for (int i = 0; i < phenoMask.size(); i++) // phenoMask.size() = size = G.phenoList.size()
-                                {
-                                    if (phenoMask[i])
-                                    {
-                                        _phenoCount++;
-                                        if (G.debugMode)cout<<"1";
-                                    }
-                                    else{if (G.debugMode)cout<<"0";}
-                                }
-                                if (G.debugMode)cout << endl;
-
-								// CHECK EACH SAMPLE IS OK - check for values of -9999 in main matrix
-                                for (int i = 0; i<_mainmatrix.getRows(); i++)
-                                {
-                                    bool indISOK = true;
-                                    if (G.debugMode){cout << G.samples[i]._name;}
-                                    if (_mainmatrix.get(i,0)==-9999){indISOK=false;}
-
-                                    for (int j = 1; j<_mainmatrix.getCols(); j++)
-                                    {
-                                        // phenotypes
-                                        if (phenoMask[j-1]){if (_mainmatrix.get(i,j)==-9999){indISOK=false;}}
-                                        if (G.debugMode){cout << " " << _mainmatrix.get(i,j);}
-                                    }
-                                    if (G.debugMode){cout << endl;}
-                                    if (indISOK)_sampleCount++;
-                                }
-
-                                if (G.debugMode)cout << "test: " << test << " indcount: " << _sampleCount << " phenocount: " <<   _phenoCount << endl;
-                                // cout << "test: " << test << " indcount: " << _sampleCount << " phenocount: " <<   _phenoCount << endl;
-
-								// CREATE NEW MATRICES (?)
-                                arrayD *Y = new arrayD ( _sampleCount );
-                                matrixD *X = new matrixD ( _sampleCount, _phenoCount+1);
-                                arrayD *W = new arrayD ( _sampleCount );
-
-                                int curInd = 0;
-                                vector <double> COPYpheno;
-
-								// ALSO CHECK EACH SAMPLE IS OK - check for values of -9999 in main matrix
-                                for (int i = 0; i<_mainmatrix.getRows(); i++)
-                                {
-                                    bool indISOK = true;
-                                    if (_mainmatrix.get(i,0)==-9999){indISOK=false;}
-                                    for (int j = 1; j<_mainmatrix.getCols(); j++)
-                                    {
-                                        if (phenoMask[j-1])
-																				{
-                                            //if (i==0)_phenoCount++;
-                                            if (_mainmatrix.get(i,j)==-9999){indISOK=false;}
-                                        }
-                                    }
-                                    if (indISOK) // IF THIS SAMPLE IS OK
-                                    {
-                                        int z=1;
-
-                                        //genotype
-                                        Y->put(curInd, _mainmatrix.get(i,0)); // GET CUMULATIVE PROBABILITIES OF MAJOR ALLELE
-                                        COPYpheno.push_back(_mainmatrix.get(i,0)); // GET CUMULATIVE PROBABILITIES OF MAJOR ALLELE
-                                        W->put(curInd,1); // IS IT FOR NULL?
-                                        X->put(curInd, 0, 1.0); // FIRST COLUMN -> 1
-
-																				// FOR EACH PHENOTYPE
-                                        for (int j = 1; j<_mainmatrix.getCols(); j++)
-                                        {
-                                            if (phenoMask[j-1])
-                                            {
-                                                X->put(curInd, z, _mainmatrix.get(i,j)); // EXTRACT PHENOTYPE VALUES FROM MAIN MATRIX
-                                                z++;
-                                            }
-                                        }
-                                        curInd++; // MOVE TO NEXT SAMPLE
-                                    }
-                                }
-
-                                // if (G.debugMode)cout << "Print Y" << endl;
-                                // if (G.debugMode)Y->print();
-                                // if (G.debugMode)cout << "Print X" << endl;
-                                // if (G.debugMode)X->print();
-
-                                // if (G.debugMode)
-                                // {
-                                //    for (int xxx=0; xxx<COPYpheno.size(); xxx++)cout<< COPYpheno[xxx];
-                                //    cout <<endl;
-                                // }
-
-																// for (int xxx=0; xxx<COPYpheno.size(); xxx++)cout<< COPYpheno[xxx];
-																//    cout <<endl; // Something different before this
-
-																// LINEAR REGRESSION
-                                lr LR;
-                                try
-																{
-																		// PERFORM WEIGHTED LINEAR REGRESSION WITH Y,X,W
-																				// Y[j]   = j-th observed data point
-																				// X[i,j] = j-th value of the i-th independent varialble
-																				// W[j]   = j-th weight value
-
-                                    if (LR.lr_w(Y, X, W) && test!=_testcount)
-                                    {
-										// COVARIANCE
-                                        matrixD * C = LR.covariance;
-
-										// INVERTED COVARIANCE
-                                        C->InvertS();
-
-                                        double x;
-                                        for (int i=0; i<(unsigned int) _phenoCount;i++)
-                                            for (int j=0; j<(unsigned int) _phenoCount;j++)
-                                                x+=LR.Cstat->get(i)*LR.Cstat->get(j)*C->get(i,j);
-
-										// LOGLIKELIHOOD - TEST & NULL
-                                        double testLogLikelihood = -LR.getLnLk(Y, X, W)/2;
-                                        double nullLogLikelihood = -LR.nullLikelihood(COPYpheno)/2;
-                                        if (G.debugMode){cout << "Linear regression done with model: " << test << endl;}
-
-										// FOR EACH PHENOTYPE -> p value for this phenotype or combination of phenotypes?
-                                        for (int k = 0; k<=_phenoCount;k++)
-                                        {
-                                            double _pPheno = (1-studenttdistribution((_sampleCount) - _phenoCount,ddabs(LR.Cstat->get(k)/LR.SECstat->get(k))))*2;
-                                            if (G.debugMode){cout << k << "\t" << (_sampleCount) << "\t" << _phenoCount << "\t" << LR.Cstat->get(k) <<  "\t" << LR.SECstat->get(k) << "\t" << _pPheno << endl;}
-                                        }
-
-										// LIKELIHOOD RATIO
-                                        double likelihoodRatio = 2 * (testLogLikelihood - nullLogLikelihood);
-
-										// BIC and BIC NULL
-                                        double _BIC = (-2 * testLogLikelihood) + ((_phenoCount+1) * log(_sampleCount));
-                                        double _BICnull = (-2 *nullLogLikelihood) + (log(_sampleCount));
-                                        //double _pModel = gsl_cdf_chisq_Q( likelihoodRatio , _phenoCount); // Overall P value - need to figure out the number of df!!!!!
-
-										// P MODEL
-										double _pModel;
-                                        if (ddabs(likelihoodRatio)>0){_pModel = 1-chisquaredistribution(_phenoCount,ddabs(likelihoodRatio));}
-                                        else {_pModel = NAN;}
-
-                                        if (G.debugMode){cout << "Likelihood: " << testLogLikelihood << endl;}
-                                        if (G.debugMode){cout << "nullLikelihood: " << nullLogLikelihood << endl;}
-                                        if (G.debugMode){cout << "Model likelihood ratio: " << likelihoodRatio << endl;}
-                                        if (G.debugMode){cout << "Model p: " << _pModel << endl;}
-                                        if (G.debugMode){LR.covariance->print();}
-
-                                        /*
-                                        cout << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" << _phenoCount << "\t";
-                                        for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){cout<<"1";}else{cout<<"0";}}
-                                        cout << "\t" << LR.getLnLk(Y, X, W) <<  "\t" << -2 * nullLikelihood(COPYpheno) <<
-                                        "\t" << likelihoodRatio << "\t" << _pModel << "\t" << _BIC << "\t" << _BICnull << "\t";
-                                        bool phenostart = true;
-                                        for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i] && phenostart){cout<<G.phenoList[i];phenostart=false;}else if(phenoMask[i]){cout << "+" <<G.phenoList[i];}}
-                                        cout << endl;
-                                        */
-
-                                        // PRINT OUT RESULTS
-                                        std::stringstream line, line2;
-
-										// BAYESIAN INFORMATION SCORE
-                                        if (_BIC < bestModel)									
-                                        {
-                                            line << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" << infoscore << "\t" << HWE(aa,aA,AA) << "\t" <<maf << "\t" << _sampleCount << "\t";
-																						if (firstIsMajorAllele){line << AA << "\t" << aA << "\t" << aa;}
-                                            else {line << aa << "\t" << aA << "\t" << AA;}
-
-                                            line << "\t" << _phenoCount << "\t";
-
-                                            for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){line<<"1";}else{line<<"0";}}
-
-                                            line << "\t" << testLogLikelihood<<  "\t" <<  nullLogLikelihood <<
-                                            "\t" << likelihoodRatio << "\t" << _pModel << "\t" << _BIC << "\t" << _BICnull << "\t";
-
-                                            //bool phenostart = true;
-                                            //for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i] && phenostart){line<<G.phenoList[i];phenostart=false;}else if(phenoMask[i]){line << "+" <<G.phenoList[i];}}
-
-											vector<string> phenosorter;
-                                            for (int i = 0; i < phenoMask.size(); i++){if(phenoMask[i])phenosorter.push_back(G.phenoList[i]);}
-                                            bool phenostart = true;
-                                            for (int i = 0; i < phenosorter.size(); i++) {if (phenostart){line<<phenosorter[i];phenostart=false;}else{line << "+" <<phenosorter[i];}}
-                                            line << "\t";
-                                            sort(phenosorter.begin(),phenosorter.end());
-                                            phenostart = true;
-                                            for (int i = 0; i < phenosorter.size(); i++) {if (phenostart){line<<phenosorter[i];phenostart=false;}else{line << "+" <<phenosorter[i];}}
-
-                                            if (G.printCovariance)
-                                            {
-                                                for (int i = 1; i < LR.Cstat->size() ;i++) line << "\t" << LR.Cstat->get(i) << "\t" <<LR.SECstat->get(i);
-                                                for (int i = 1; i < LR.Cstat->size();i++)
-                                                {
-                                                    for (int j = i; j < LR.Cstat->size();j++)
-                                                        line << "\t" << LR.covariance->get(i,j);
-                                                }
-                                            }
-
-                                            line << endl;
-                                            bestModelString = line.str();
-
-                                            int k=1;
-                                            for (int i = 0; i < phenoMask.size(); i++)
-                                            {
-                                                if (phenoMask[i])
-                                                {
-                                                    line2 << markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" <<  _sampleCount << "\t";
-                                                    bool phenostart = true;
-                                                    for (int j = 0; j < phenoMask.size(); j++)
-                                                    {
-                                                        if (phenoMask[j] && phenostart)
-                                                        {
-                                                            line2<<G.phenoList[j];
-                                                            phenostart=false;
-                                                        }
-                                                        else if(phenoMask[j])
-                                                        {
-                                                            line2 << "+" <<G.phenoList[j];
-                                                        }
-                                                    }
-                                                    line2  << "\t" << G.phenoList[i] << "\t" << LR.Cstat->get(k) << "\t" << LR.SECstat->get(k) << endl;
-                                                    k++;
-                                                }
-                                            }
-                                            bestBetasString = line2.str();
-                                            bestModel = _BIC;
-                                        }
-                                        if (G.printAll || G.printComplex)
-                                        {
-
-                                            OUT << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" << infoscore << "\t" << HWE(aa,aA,AA) << "\t" <<maf << "\t" << _sampleCount << "\t";
-                                            if (firstIsMajorAllele){OUT << AA << "\t" << aA << "\t" << aa;}
-                                            else {OUT << aa << "\t" << aA << "\t" << AA;}
-
-                                            OUT << "\t" << _phenoCount << "\t";
-                                            for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){OUT<<"1";}else{OUT<<"0";}}
-                                            OUT << "\t" << testLogLikelihood <<  "\t" <<  nullLogLikelihood <<
-                                            "\t" << likelihoodRatio << "\t" << _pModel << "\t" << _BIC << "\t" << _BICnull << "\t";
-                                            //bool phenostart = true;
-                                            //for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i] && phenostart){OUT<<G.phenoList[i];phenostart=false;}else if(phenoMask[i]){OUT << "+" <<G.phenoList[i];}}
-                                            vector<string> phenosorter;
-                                            for (int i = 0; i < phenoMask.size(); i++){if(phenoMask[i])phenosorter.push_back(G.phenoList[i]);}
-                                            bool phenostart = true;
-                                            for (int i = 0; i < phenosorter.size(); i++) {if (phenostart){OUT<<phenosorter[i];phenostart=false;}else{OUT << "+" <<phenosorter[i];}}
-                                            OUT << "\t";
-                                            sort(phenosorter.begin(),phenosorter.end());
-                                            phenostart = true;
-                                            for (int i = 0; i < phenosorter.size(); i++) {if (phenostart){OUT<<phenosorter[i];phenostart=false;}else{OUT << "+" <<phenosorter[i];}}
-                                            if (G.printCovariance)
-                                            {
-                                                for (int i = 1; i < LR.Cstat->size() ;i++) OUT << "\t" << LR.Cstat->get(i) << "\t" <<LR.SECstat->get(i);
-                                                for (int i = 1; i < LR.Cstat->size();i++)
-                                                {
-                                                    for (int j = i; j < LR.Cstat->size();j++)
-                                                        OUT << "\t" << LR.covariance->get(i,j);
-                                                }
-                                            }
-
-                                            OUT << endl;
-                                            int k=1;
-                                            for (int i = 0; i < phenoMask.size(); i++)
-                                            {
-                                                if (phenoMask[i])
-                                                {
-                                                    if (G.printBetas) BETAS << markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" <<  _sampleCount << "\t";
-                                                    bool phenostart = true;
-                                                    for (int j = 0; j < phenoMask.size(); j++)
-                                                    {
-                                                        if (phenoMask[j] && phenostart)
-                                                        {
-                                                            if (G.printBetas) BETAS<<G.phenoList[j];
-                                                            phenostart=false;
-                                                        }
-                                                        else if(phenoMask[j])
-                                                        {
-                                                            if (G.printBetas) BETAS << "+" <<G.phenoList[j];
-                                                        }
-                                                    }
-                                                    if (G.printBetas) BETAS  << "\t" << G.phenoList[i] << "\t" << LR.Cstat->get(k) << "\t" << LR.SECstat->get(k) << endl;
-                                                    k++;
-                                                }
-                                            }
-                                        }
-
-                                      	/*else if ((LR.getLnLk(Y, X, W) <= (-2 * nullLikelihood(COPYpheno))) && ((-2 * nullLikelihood(COPYpheno)) > bestModel))
-                                        {
-                                            line << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" << 0 << "\t";
-                                            for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){line<<"0";}else{line<<"0";}}
-                                            line << "\t" <<-2 * nullLikelihood(COPYpheno)  <<  "\t" << -2 * nullLikelihood(COPYpheno) <<
-                                            "\t" << 1 << "\t" << 1 << "\t" << _BICnull << "\t" << _BICnull << "\tnull\n";
-                                            bestModelString = line.str();
-                                            bestModel = (-2 * nullLikelihood(COPYpheno));
-                                        }*/
-                                       	// cout << setprecision(4) << test << " " << Pmodel << " "
-                                       	// << LR.Cstat->get(3) << " " << LR.SECstat->get(3) << " " << P1 << " "
-                                       	// << LR.Cstat->get(1) << " " << LR.SECstat->get(2) << " " << P2 << " "
-                                       	// << LR.Cstat->get(2) << " " << LR.SECstat->get(2) << " " << P3 << "\n" ;
-                                    }
-                                    else
-                                    {
-                                        if (test!=_testcount) LOG << "Collinearity problem with model: " << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << test << " " << _testcount << " ";
-                                        bool phenostart = true;
-                                        for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i] && phenostart){LOG<<G.phenoList[i];phenostart=false;}else if(phenoMask[i]){LOG << "+" <<G.phenoList[i];}}
-                                        LOG << endl;
-                                    }
-
-                                }
-																catch (ArgException &e)  // catch any exceptions
-                                { cerr << "error: " << e.error() << " for linear model " << e.argId() << endl; }
-                                delete X;
-                                delete Y;
-                                delete W;
-                                if (G.printComplex){break;}
-                            }
-
-                            if (!G.printAll && !G.printComplex)
-                            {
-                                if (G.printBetas)BETAS << bestBetasString;
-                                OUT << bestModelString;
-                            }
-                        }
+                        const char * eol = (const char *) memchr(p, '\n', chunkEnd - p);
+                        if (!eol) eol = chunkEnd;
+                        if (!readMarker(S, p, eol, SCREEN, analyse)) return false;
+                        p = eol + 1;
                     }
+                    return true;
+                });
+                begin = end;
+            }
+            if (!POOL.finish()) exit(1);
+        }
+        else
+        {
+            genState S;
+            auto submit = [&POOL](variant & V){POOL.submit(V);};
+            if (M.isOpen())
+            {
+                M.sequential();
+                const char * p = M.data();
+                const char * end = p + M.size();
+                while (p < end)
+                {
+                    const char * eol = (const char *) memchr(p, '\n', end - p);
+                    if (!eol) eol = end;
+                    if (!readMarker(S, p, eol, cout, submit)) exit(1);
+                    p = eol + 1;
+                }
+            }
+            else
+            {
+                ifstream F (G.inputGenFile.c_str());
+                if (F.is_open())
+                {
+                    string line;
+                    while (getline(F, line))
+                        if (!readMarker(S, line.data(), line.data() + line.size(), cout, submit)) exit(1);
                 }
+                else {cout << "Cannot read genotype file. Exit program!" << endl; exit(1);}
             }
         }
-        else {cout << "Cannot read genotype file. Exit program!" << endl; exit(1);}
     }
 
 		// READING GZ GEN FILE
     if (G.inputGenFile.substr(G.inputGenFile.length()-2)=="gz")
     {
-        //      	ifstream F (G.inputGenFile.c_str());
-        gzFile F =gzopen(G.inputGenFile.c_str(),"r");
-        char *buffer = new char[LENS];
-        while(0!=gzgets(F,buffer,LENS))
+        gzLineReader F;
+        if (!F.open(G.inputGenFile, G.threads)) {cout << "Cannot read genotype file. Exit program!" << endl; exit(1);}
+        genLine L;                          // fields and probabilities of the current line, reused for every marker
+        vector <double> dose, firstDose;    // dosages of second/first allele, reused for every marker
+        variant V;
+        const char * lineBegin;
+        const char * lineEnd;
+        while (F.next(&lineBegin, &lineEnd))
         {
-                string line;
-                vector<string> tokens;
-
-                string currentmarker = "";
-                int n = Tokenize(buffer, tokens, " ");            //tabulating file by space
-                if (n>2 && !G.exclusionList[string(tokens[1])])
+                int n = L.parse(lineBegin, lineEnd, 5);     // leading columns as views, probabilities as numbers
+                if (n>4 && !skipMarker(G, L.fields[1], L.fields[1], L.fields[0], L.fields[2]))
                 {
                     int chr;
-                    if (uc(tokens[0])=="MT") chr=26;
-                    else if (uc(tokens[0])=="XY") chr=25;
-                    else if (uc(tokens[0])=="Y") chr=24;
-                    else if (uc(tokens[0])=="X") chr=23;
-                    else chr = atoi(tokens[0].c_str());
+                    string chrName(L.fields[0]);
+                    if (uc(chrName)=="MT") chr=26;
+                    else if (uc(chrName)=="XY") chr=25;
+                    else if (uc(chrName)=="Y") chr=24;
+                    else if (uc(chrName)=="X") chr=23;
+                    else chr = atoi(chrName.c_str());
 
                     if (G.chr)chr=G.chr;
                     if (G.debugMode) cout << "Chromosome id: " << chr;
-                    int pos = atoi(tokens[2].c_str());
-                    string markerName = string(tokens[1]);
-                    string effectAllele = tokens[4];
-                    string nonEffectAllele = tokens[3];
+                    int pos = atoi(string(L.fields[2]).c_str());
+                    string markerName = string(L.fields[1]);
+                    string effectAllele = string(L.fields[4]);
+                    string nonEffectAllele = string(L.fields[3]);
                     if (G.debugMode) cout << "Pos: " << pos << "\nmarker:" << markerName << "\nea/nea:" << effectAllele <<"/" << nonEffectAllele<<"\n";
 
-                    vector <double> gen;
-                    vector <double> gen2;
-                    int j = 0;
+                    // one pass over the triplets of all samples (some gzipped files have odd number of columns)
+                    int sampleCount = (n-5)/3;
                     double aa=0; double aA=0; double AA=0;
                     double callrate=0; double ok_gen=0; double not_ok_gen=0;
-                    double bestModel = 1e200;
-                    string bestModelString = "";
-                    string bestBetasString = "";
                     double fijeij = 0; //for infoscore
-                    double infoscore = 1;
-                    for (int i = 5; i < n-1; i+=3)
+                    dose.resize(sampleCount);
+                    firstDose.resize(sampleCount);
+                    const double * P = L.probs.data();
+                    for (int k = 0; k < sampleCount; k++, P+=3)
                     {
-                        //granvil copypaste
+                        double p0 = P[0];
+                        double p1 = P[1];
+                        double p2 = P[2];
+
 												// Calculate the probabilities of aa, aA, AA
-                        aa+=atof(tokens[i].c_str());
-                        aA+=atof(tokens[i+1].c_str());
-                        AA+=atof(tokens[i+2].c_str());
+                        aa+=p0;
+                        aA+=p1;
+                        AA+=p2;
 
-												// Calculate probabilities of each allele a & A
-                        gen2.push_back(((atof(tokens[i+2].c_str())*2) + atof(tokens[i+1].c_str())));
-                        gen.push_back(((atof(tokens[i].c_str())*2) + atof(tokens[i+1].c_str())));
+												// Dosages of alleles A & a
+                        dose[k] = (p2*2) + p1;
+                        firstDose[k] = (p0*2) + p1;
 
 												// To count # of samples & call rate
                         ok_gen++;
 
 												// To calculate info score
-                        double eij=(2*atof(tokens[i+2].c_str())) + atof(tokens[i+1].c_str());
-                        double fij = (4*atof(tokens[i+2].c_str())) + atof(tokens[i+1].c_str());
+                        double eij=(2*p2) + p1;
+                        double fij = (4*p2) + p1;
                         fijeij+= fij - (eij*eij);
-
-												// Not sure what this is for
-                        j++;
                     }
 
 										// Make sure # of samples consistent in genotype & phenotype files
-                    if (ok_gen+not_ok_gen!=G.samples.size())
+                    if (ok_gen+not_ok_gen!=G.phenotypes.sampleCount())
                     {
-                        cout << "The number of samples in genotype file (" << ok_gen+not_ok_gen << ") does not match the number of samples in sample file (" << G.samples.size() << "). Exit program!" << endl;
+                        cout << "The number of samples in genotype file (" << ok_gen+not_ok_gen << ") does not match the number of samples in sample file (" << G.phenotypes.sampleCount() << "). Exit program!" << endl;
                         exit (1);
                     }
 
@@ -1534,356 +1705,24 @@ readGenoFile(global & G, ofstream & LOG)
                     if (G.debugMode)cout<<"Callrate: "<< callrate <<endl;
 
 										// MAF & INFO SCORE
-                    double maf = 0;
-                    if (aa+aA+AA>0)
+                    V.aa = aa; V.aA = aA; V.AA = AA;
+                    if (variantQC(G, V, fijeij))
                     {
-                        maf = ((2*aa)+aA)/(2*(aa+aA+AA));
+                        // DOSAGE OF EFFECT ALLELE FOR EACH SAMPLE
+                        V.chr = chr; V.pos = pos; V.markerName = markerName;
+                        if (V.firstIsMajorAllele) swap(effectAllele, nonEffectAllele);
+                        V.effectAllele = effectAllele; V.nonEffectAllele = nonEffectAllele;
+                        if (V.firstIsMajorAllele) V.dose = firstDose;
+                        else V.dose = dose;
+                        POOL.submit(V);
                     }
-                    if (maf==0){infoscore=1;}
-                    //info score calculation according to the measure in snptest:
-                    //https://mathgen.stats.ox.ac.uk/genetics_software/snptest/snptest.v2.pdf
-                    else
-                    {
-                        infoscore = 1-(fijeij/(2*(aa+aA+AA)*maf*(1-maf)));
-                    }
-
-                    bool firstIsMajorAllele = false;
-                    if (maf>0.5)
-                    {
-                        maf=1-maf;
-                        firstIsMajorAllele=true;
-                        effectAllele = tokens[3];
-                        nonEffectAllele = tokens[4];
-                    }
-                    if (G.debugMode)cout<<"MAF: "<< maf <<endl;
-                    if (maf>0) //marker is ok - Sham'st thou to show thy dangerous brow by night, When evils are most free?
-                    {
-                        infoscore = 1-(fijeij/(2*(aa+aA+AA)*maf*(1-maf)));
-                        if (infoscore >= G.threshold)
-                        {
-                            unsigned int _rows = (n-5)/3;
-                            unsigned int _cols = (unsigned int) G.phenoList.size()+1;
-                            if (G.debugMode)cout << "Mainmatrix x: " << _rows << " y: " <<  _cols << endl;
-                            matrixD _mainmatrix(_rows, _cols); //[0]-Y(0,1,2,3); [1]-.. X1,X2,X3...
-                            int curind=0;
-                            for (int i = 5; i < n-1; i+=3)
-                            {
-                                if (firstIsMajorAllele)
-                                {
-                                    _mainmatrix.put(curind,0,((atof(tokens[i].c_str())*2) + atof(tokens[i+1].c_str())));
-                                }
-                                else
-                                {
-                                    _mainmatrix.put(curind,0,((atof(tokens[i+2].c_str())*2) + atof(tokens[i+1].c_str())));
-
-                                }
-                                for (int j = 0; j<G.phenoList.size(); j++)
-                                {
-                                    string xxy = G.samples[curind]._name;
-                               //     int xxyy = j;
-                                 //   double xxx = G.samples[curind]._phenos[j];
-
-                                    _mainmatrix.put(curind,j+1,G.samples[curind]._phenos[j]);
-                                }
-                                curind++;
-                            }
-
-														// MAIN MATRIX READY FOR ANALYSIS
-                            //We have main table now - lets run through all possible combinations of phenotypes
-                            //if (G.debugMode)_mainmatrix.print();
-
-                            int _testcount = pow(2,G.phenoList.size()); //
-                            for (int test=_testcount-1; test>=1; test--)
-                            {
-                                int _phenoCount = 0;
-                                int _sampleCount = 0;
-                                vector<bool> phenoMask = phenoMasker(test,(int)G.phenoList.size()); // In tools.cpp, takes # of variant and size
-
-                                if (G.debugMode)cout << "Current mask: ";
-                                for (int i = 0; i < phenoMask.size(); i++)
-                                {
-                                    if (phenoMask[i])
-                                    {
-                                        _phenoCount++;
-                                        if (G.debugMode)cout<<"1";
-                                    }
-                                    else{if (G.debugMode)cout<<"0";}
-                                }
-                                if (G.debugMode)cout << endl;
-
-
-                                for (int i = 0; i<_mainmatrix.getRows(); i++)
-                                {
-                                    bool indISOK = true;
-                                    if (G.debugMode){cout << G.samples[i]._name;}
-                                    if (_mainmatrix.get(i,0)==-9999){indISOK=false;}
-
-                                    for (int j = 1; j<_mainmatrix.getCols(); j++)
-                                    {
-
-                                        //phenotypes
-                                        if (phenoMask[j-1]){
-                                            //if (i==0)_phenoCount++;
-                                            if (_mainmatrix.get(i,j)==-9999){indISOK=false;}
-                                        }
-                                        if (G.debugMode){cout << " " << _mainmatrix.get(i,j);}
-
-                                    }
-                                    if (G.debugMode){cout << endl;}
-
-                                    if (indISOK)_sampleCount++;
-                                }
-                                if (G.debugMode)cout << "test: " << test << " indcount: " << _sampleCount << " phenocount: " <<   _phenoCount << endl;
-                                arrayD *Y = new arrayD ( _sampleCount );
-                                matrixD *X = new matrixD ( _sampleCount, _phenoCount+1);
-                                arrayD *W = new arrayD ( _sampleCount );
-                                int curInd = 0;
-                                vector <double> COPYpheno;
-                                for (int i = 0; i<_mainmatrix.getRows(); i++)
-                                {
-                                    bool indISOK = true;
-                                    if (_mainmatrix.get(i,0)==-9999){indISOK=false;}
-                                    for (int j = 1; j<_mainmatrix.getCols(); j++)
-                                    {
-
-                                        if (phenoMask[j-1]){
-                                            //if (i==0)_phenoCount++;
-                                            if (_mainmatrix.get(i,j)==-9999){indISOK=false;}
-                                        }
-                                    }
-                                    if (indISOK)
-                                    {
-                                        int z=1;
-
-                                        //genotype
-                                        Y->put(curInd, _mainmatrix.get(i,0));
-                                        COPYpheno.push_back(_mainmatrix.get(i,0));
-
-                                        W->put(curInd,1);
-                                        X->put(curInd, 0,  1.0);
-
-                                        for (int j = 1; j<_mainmatrix.getCols(); j++)
-                                        {
-                                            if (phenoMask[j-1])
-                                            {
-                                                X->put(curInd, z, _mainmatrix.get(i,j));
-                                                z++;
-                                            }
-                                        }
-                                        curInd++;
-                                    }
-                                }
-                                //if (G.debugMode)cout << "Print Y" << endl;
-                                //if (G.debugMode)Y->print();
-                                //if (G.debugMode)cout << "Print X" << endl;
-                                //if (G.debugMode)X->print();
-                                //if (G.debugMode)
-                                //{
-                                //    for (int xxx=0; xxx<COPYpheno.size(); xxx++)cout<< COPYpheno[xxx];
-                                //    cout <<endl;
-                                //}
-
-                                lr LR;
-                                try {
-                                    if (LR.lr_w(Y, X, W) && test!=_testcount)
-                                    {
-                                        matrixD * C = LR.covariance;
-                                        C->InvertS();
-                                        double x;
-                                        for (int i=0; i<(unsigned int) _phenoCount;i++)
-                                            for (int j=0; j<(unsigned int) _phenoCount;j++)
-                                                x+=LR.Cstat->get(i)*LR.Cstat->get(j)*C->get(i,j);
-                                        double testLogLikelihood = -LR.getLnLk(Y, X, W)/2;
-                                        double nullLogLikelihood = -LR.nullLikelihood(COPYpheno)/2;
-                                        if (G.debugMode){cout << "Linear regression done with model: " << test << endl;}
-                                        for (int k = 0; k<=_phenoCount;k++)
-                                        {
-                                            double _pPheno = (1-studenttdistribution((_sampleCount*2) - _phenoCount,ddabs(LR.Cstat->get(k)/LR.SECstat->get(k))))*2;
-                                            if (G.debugMode){cout << k << "\t" << (_sampleCount*2) << "\t" << _phenoCount << "\t" << LR.Cstat->get(k) <<  "\t" << LR.SECstat->get(k) << "\t" << _pPheno << endl;}
-
-                                        }
-                                        double likelihoodRatio = 2 * (testLogLikelihood - nullLogLikelihood);
-                                        double _BIC = (-2 * testLogLikelihood) + ((_phenoCount+1) * log(_sampleCount));
-                                        double _BICnull = (-2 *nullLogLikelihood) + (log(_sampleCount));
-                                        //double _pModel = gsl_cdf_chisq_Q( likelihoodRatio , _phenoCount); // Overall P value - need to figure out the number of df!!!!!
-                                        double _pModel;
-                                        if (ddabs(likelihoodRatio)>0){_pModel = 1-chisquaredistribution(_phenoCount,ddabs(likelihoodRatio));}
-                                        else {_pModel = NAN;}
-
-                                        if (G.debugMode){cout << "Likelihood: " << testLogLikelihood << endl;}
-                                        if (G.debugMode){cout << "nullLikelihood: " << nullLogLikelihood << endl;}
-                                        if (G.debugMode){cout << "Model likelihood ratio: " << likelihoodRatio << endl;}
-                                        if (G.debugMode){cout << "Model p: " << _pModel << endl;}
-
-                                        /*
-                                         cout << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" << _phenoCount << "\t";
-                                         for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){cout<<"1";}else{cout<<"0";}}
-                                         cout << "\t" << LR.getLnLk(Y, X, W) <<  "\t" << -2 * nullLikelihood(COPYpheno) <<
-                                         "\t" << likelihoodRatio << "\t" << _pModel << "\t" << _BIC << "\t" << _BICnull << "\t";
-                                         bool phenostart = true;
-                                         for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i] && phenostart){cout<<G.phenoList[i];phenostart=false;}else if(phenoMask[i]){cout << "+" <<G.phenoList[i];}}
-                                         cout << endl;
-                                         */
-                                        std::stringstream line, line2;
-                                        if (_BIC < bestModel)
-                                        {
-
-                                            line << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" << infoscore << "\t" << HWE(aa,aA,AA) << "\t" <<maf << "\t" << _sampleCount << "\t";
-                                            if (firstIsMajorAllele){line << AA << "\t" << aA << "\t" << aa;}
-                                            else {line << aa << "\t" << aA << "\t" << AA;}
-                                            line << "\t" << _phenoCount << "\t";
-                                            for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){line<<"1";}else{line<<"0";}}
-                                            line << "\t" << testLogLikelihood<<  "\t" <<  nullLogLikelihood <<
-                                            "\t" << likelihoodRatio << "\t" << _pModel << "\t" << _BIC << "\t" << _BICnull << "\t";
-                                            //bool phenostart = true;
-                                            //for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i] && phenostart){line<<G.phenoList[i];phenostart=false;}else if(phenoMask[i]){line << "+" <<G.phenoList[i];}}
-                                            vector<string> phenosorter;
-                                            for (int i = 0; i < phenoMask.size(); i++){if(phenoMask[i])phenosorter.push_back(G.phenoList[i]);}
-                                            bool phenostart = true;
-                                            for (int i = 0; i < phenosorter.size(); i++) {if (phenostart){line<<phenosorter[i];phenostart=false;}else{line << "+" <<phenosorter[i];}}
-                                            line << "\t";
-                                            sort(phenosorter.begin(),phenosorter.end());
-                                            phenostart = true;
-                                            for (int i = 0; i < phenosorter.size(); i++) {if (phenostart){line<<phenosorter[i];phenostart=false;}else{line << "+" <<phenosorter[i];}}
-
-                                            if (G.printCovariance)
-                                            {
-                                                for (int i = 1; i < LR.Cstat->size() ;i++) line << "\t" << LR.Cstat->get(i) << "\t" <<LR.SECstat->get(i);
-                                                for (int i = 1; i < LR.Cstat->size();i++)
-                                                {
-                                                    for (int j = i; j < LR.Cstat->size();j++)
-                                                        line << "\t" << LR.covariance->get(i,j);
-                                                }
-                                            }
-                                            line << endl;
-                                            bestModelString = line.str();
-
-                                            int k=1;
-                                            for (int i = 0; i < phenoMask.size(); i++)
-                                            {
-                                                if (phenoMask[i])
-                                                {
-                                                    line2 << markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" <<  _sampleCount << "\t";
-                                                    bool phenostart = true;
-                                                    for (int j = 0; j < phenoMask.size(); j++)
-                                                    {
-                                                        if (phenoMask[j] && phenostart)
-                                                        {
-                                                            line2<<G.phenoList[j];
-                                                            phenostart=false;
-                                                        }
-                                                        else if(phenoMask[j])
-                                                        {
-                                                            line2 << "+" <<G.phenoList[j];
-                                                        }
-                                                    }
-                                                    line2  << "\t" << G.phenoList[i] << "\t" << LR.Cstat->get(k) << "\t" << LR.SECstat->get(k) << endl;
-                                                    k++;
-                                                }
-                                            }
-                                            bestBetasString = line2.str();
-                                            bestModel = _BIC;
-                                        }
-                                        if (G.printAll || G.printComplex)
-                                        {
-
-                                            OUT << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" << infoscore << "\t" << HWE(aa,aA,AA) << "\t" <<maf << "\t" << _sampleCount << "\t";
-                                            if (firstIsMajorAllele){OUT << AA << "\t" << aA << "\t" << aa;}
-                                            else {OUT << aa << "\t" << aA << "\t" << AA;}
-
-                                            OUT << "\t" << _phenoCount << "\t";
-                                            for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){OUT<<"1";}else{OUT<<"0";}}
-                                            OUT << "\t" << testLogLikelihood <<  "\t" <<  nullLogLikelihood <<
-                                            "\t" << likelihoodRatio << "\t" << _pModel << "\t" << _BIC << "\t" << _BICnull << "\t";
-                                            //bool phenostart = true;
-                                            //for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i] && phenostart){OUT<<G.phenoList[i];phenostart=false;}else if(phenoMask[i]){OUT << "+" <<G.phenoList[i];}}
-                                            vector<string> phenosorter;
-                                            for (int i = 0; i < phenoMask.size(); i++){if(phenoMask[i])phenosorter.push_back(G.phenoList[i]);}
-                                            bool phenostart = true;
-                                            for (int i = 0; i < phenosorter.size(); i++) {if (phenostart){OUT<<phenosorter[i];phenostart=false;}else{OUT << "+" <<phenosorter[i];}}
-                                            OUT << "\t";
-                                            sort(phenosorter.begin(),phenosorter.end());
-                                            phenostart = true;
-
-                                            for (int i = 0; i < phenosorter.size(); i++) {if (phenostart){OUT<<phenosorter[i];phenostart=false;}else{OUT << "+" <<phenosorter[i];}}
-
-                                            if (G.printCovariance)
-                                            {
-                                                for (int i = 1; i < LR.Cstat->size() ;i++) OUT << "\t" << LR.Cstat->get(i) << "\t" <<LR.SECstat->get(i);
-                                                for (int i = 1; i < LR.Cstat->size();i++)
-                                                {
-                                                    for (int j = i; j < LR.Cstat->size();j++)
-                                                        OUT << "\t" << LR.covariance->get(i,j);
-                                                }
-                                            }
-                                            OUT << endl;
-                                            int k=1;
-                                            for (int i = 0; i < phenoMask.size(); i++)
-                                            {
-                                                if (phenoMask[i])
-                                                {
-                                                    if (G.printBetas) BETAS << markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" <<  _sampleCount << "\t";
-                                                    bool phenostart = true;
-                                                    for (int j = 0; j < phenoMask.size(); j++)
-                                                    {
-                                                        if (phenoMask[j] && phenostart)
-                                                        {
-                                                            if (G.printBetas) BETAS<<G.phenoList[j];
-                                                            phenostart=false;
-                                                        }
-                                                        else if(phenoMask[j])
-                                                        {
-                                                            if (G.printBetas) BETAS << "+" <<G.phenoList[j];
-                                                        }
-                                                    }
-                                                    if (G.printBetas) BETAS  << "\t" << G.phenoList[i] << "\t" << LR.Cstat->get(k) << "\t" << LR.SECstat->get(k) << endl;
-                                                    k++;
-                                                }
-                                            }
-                                        }
-
-                                        /*else if ((LR.getLnLk(Y, X, W) <= (-2 * nullLikelihood(COPYpheno))) && ((-2 * nullLikelihood(COPYpheno)) > bestModel))
-                                         {
-                                         line << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << effectAllele <<"\t" << nonEffectAllele<< "\t" << 0 << "\t";
-                                         for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i]){line<<"0";}else{line<<"0";}}
-                                         line << "\t" <<-2 * nullLikelihood(COPYpheno)  <<  "\t" << -2 * nullLikelihood(COPYpheno) <<
-                                         "\t" << 1 << "\t" << 1 << "\t" << _BICnull << "\t" << _BICnull << "\tnull\n";
-                                         bestModelString = line.str();
-                                         bestModel = (-2 * nullLikelihood(COPYpheno));
-                                         }*/
-                                        // cout << setprecision(4) << test << " " << Pmodel << " "
-                                        // << LR.Cstat->get(3) << " " << LR.SECstat->get(3) << " " << P1 << " "
-                                        // << LR.Cstat->get(1) << " " << LR.SECstat->get(2) << " " << P2 << " "
-                                        // << LR.Cstat->get(2) << " " << LR.SECstat->get(2) << " " << P3 << "\n" ;
-                                    }
-                                    else
-                                    {
-                                        if (test!=_testcount) LOG << "Collinearity problem with model: " << chr << "\t"<<  pos << "\t" <<  markerName << "\t" << test << " " << _testcount << " ";
-                                        bool phenostart = true;
-                                        for (int i = 0; i < phenoMask.size(); i++) {if (phenoMask[i] && phenostart){LOG<<G.phenoList[i];phenostart=false;}else if(phenoMask[i]){LOG << "+" <<G.phenoList[i];}}
-                                        LOG << endl;
-                                    }
-
-                                } catch (ArgException &e)  // catch any exceptions
-                                { cerr << "error: " << e.error() << " for linear model " << e.argId() << endl; }
-                                delete X;
-                                delete Y;
-                                delete W;
-                                if (G.printComplex){break;}
-                            }
-
-                            if (!G.printAll && !G.printComplex)
-                            {
-                                if (G.printBetas)BETAS << bestBetasString;
-                                OUT << bestModelString;
-                            }
-                        } //infoscore end i think
-
-                    } //maf > 0 end (i think)
             }
         }
-
+        if (F.error()) {cout << "Genotype file is corrupt or truncated. Exit program!" << endl; exit(1);}
     }
 
+    if (!POOL.finish()) exit(1);
+    POOL.report(LOG);
+    if (!OUT.close() || !BETAS.close()) {cout << "Cannot write output files. Exit program!" << endl; exit(1);}
     return true;
 }
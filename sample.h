@@ -20,20 +20,57 @@
 
 
 //
+#include <stdint.h>
 #include <vector>
+#include "TOOLS/aligned.h"
 
 #ifndef PLEIOTROPY_sample_h
 #define PLEIOTROPY_sample_h
 
-class sample
+#define MISSING_PHENOTYPE -9999
+
+// Phenotypes of all samples, loaded once from the sample file. Every phenotype
+// is a column of its own, starting on a cache line and padded to whole cache
+// lines, with a bitmap of the samples that have a value. Missing values are
+// stored as 0, so a column can be summed without looking at the bitmap.
+class phenotypeTable
 {
 public:
-//	sample(void);
-//	~sample(void);
+    phenotypeTable(): _sampleCount(0), _phenoCount(0), _stride(0), _words(0) {}
+
+    // rows: phenotypes of one sample after the other, MISSING_PHENOTYPE if missing
+    void load(const std::vector <double> & rows, int phenoCount)
+    {
+        _phenoCount = phenoCount;
+        _sampleCount = phenoCount ? (int) (rows.size() / phenoCount) : 0;
+        int perLine = CACHE_LINE / sizeof(double);
+        _stride = (_sampleCount + perLine - 1) / perLine * perLine;
+        _words = (_sampleCount + 63) / 64;
+        _values.assign((size_t) _stride * _phenoCount, 0);
+        _present.assign((size_t) _words * _phenoCount, 0);
+        for (int k = 0; k < _sampleCount; k++)
+            for (int j = 0; j < _phenoCount; j++)
+            {
+                double x = rows[(size_t) k * _phenoCount + j];
+                if (x == MISSING_PHENOTYPE) continue;
+                _values[(size_t) j * _stride + k] = x;
+                _present[(size_t) j * _words + k / 64] |= (uint64_t) 1 << (k % 64);
+            }
+    }
+
+    int sampleCount() const {return _sampleCount;}
+    int phenoCount() const {return _phenoCount;}
+    const double * column(int j) const {return &_values[(size_t) j * _stride];}
+    const uint64_t * presence(int j) const {return &_present[(size_t) j * _words];}  // bit k: sample k has a value
+    bool present(int j, int k) const {return (presence(j)[k / 64] >> (k % 64)) & 1;}
 
-	std::string _name;
-    std::vector <double> _phenos;
-    bool isOK;
+private:
+    int _sampleCount;
+    int _phenoCount;
+    int _stride;                    // doubles per column
+    int _words;                     // bitmap words per column
+    alignedDoubles _values;         // column-major
+    std::vector <uint64_t> _present;
 };
 
 
@@ -0,0 +1,67 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// SCOPA_CONVERT: writes a binary result file of SCOPA --binary as the text .result file
+
+#include <fstream>
+#include <iostream>
+#include "TOOLS/resultfile.h"
+
+using namespace std;
+
+int
+main(int argc, char * argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        cerr << "Usage: SCOPA_CONVERT <file.rbin> [<file.result>]" << endl;
+        cerr << "Writes the results as text to <file.result>, or to the screen if it is not given." << endl;
+        return 1;
+    }
+    ifstream IN(argv[1], ios::in | ios::binary);
+    if (!IN.is_open())
+    {
+        cerr << "Cannot open " << argv[1] << endl;
+        return 1;
+    }
+    ofstream FILE;
+    if (argc == 3)
+    {
+        FILE.open(argv[2]);
+        if (!FILE.is_open())
+        {
+            cerr << "Cannot write " << argv[2] << endl;
+            return 1;
+        }
+    }
+    ostream & OUT = argc == 3 ? FILE : cout;
+    if (!resultFile::toText(IN, OUT))
+    {
+        cerr << argv[1] << " is not a valid SCOPA binary result file" << endl;
+        return 1;
+    }
+    OUT.flush();
+    if (!OUT)
+    {
+        cerr << "Error writing the results" << endl;
+        return 1;
+    }
+    return 0;
+}
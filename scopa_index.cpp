@@ -0,0 +1,55 @@
+/*************************************************************************
+ SCOPA software:  March, 2016
+
+ Contributors:
+ * Andrew P Morris A.P.Morris@liverpool.ac.uk
+ * Reedik Magi reedik.magi@ut.ee
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+// SCOPA_INDEX: builds the variant index (<file.bgen>.scopaidx) of BGEN files ahead of
+// runs with --range, --snp, --snp_list or an inclusion list
+
+#include <iostream>
+#include "TOOLS/bgenindex.h"
+
+using namespace std;
+
+int
+main(int argc, char * argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: SCOPA_INDEX <file.bgen> [<file.bgen> ...]" << endl;
+        cerr << "Writes the variant index of every file next to it as <file.bgen>.scopaidx." << endl;
+        return 1;
+    }
+    int failed = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        bgenIndex index;
+        if (!index.build(argv[i]))
+        {
+            cerr << argv[i] << " cannot be read or is not a BGEN v1.1/v1.2 file" << endl;
+            failed++;
+        }
+        else if (!index.save(argv[i]))
+        {
+            cerr << "Cannot write " << bgenIndex::fileName(argv[i]) << endl;
+            failed++;
+        }
+        else cout << bgenIndex::fileName(argv[i]) << ": " << index.size() << " variants" << endl;
+    }
+    return failed ? 1 : 0;
+}